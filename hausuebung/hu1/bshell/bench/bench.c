@@ -0,0 +1,626 @@
+/*
+ * bench.c
+ *
+ * Benchmark driver for bshell (CMake target "bench").
+ *
+ * Generates reproducible script workloads, runs each of them with bshell and
+ * with the locally installed reference shells (dash, bash) and reports per
+ * shell and workload the median of several runs:
+ *
+ *   wall time, user + system CPU time, context switches (voluntary and
+ *   involuntary) and max RSS, all taken from wait4().
+ *
+ * The pipe_N workloads measure pipeline setup (N = 2 .. 5000 stages), the
+ * pipesz_* workloads pipe throughput with different pipe buffer sizes; for
+ * those mb_s and csw_per_gb are filled in (otherwise "-"). while_1m runs one
+ * million loop iterations of builtins, wall_ms / 1000 is the cost of one
+ * iteration in microseconds.
+ *
+ * Workloads that count operations (spawns, commands, reaps) also report
+ * ops_s and us_op. The spawn_rss_* workloads first inflate the shell's heap
+ * (bshell --inflate-heap=MB, a large variable in dash/bash); the time of an
+ * otherwise empty script with the same heap is measured as well and taken
+ * off before ops_s and us_op are computed.
+ *
+ * parse_only runs a 16 MiB script with -n (parse, do not execute) in all
+ * shells; its mb_s is the parser throughput.
+ *
+ * The result is a tab separated table with a header line, so two runs can be
+ * compared with diff or loaded into any spreadsheet:
+ *
+ *   bshell_bench --shell ./shell [--compare dash,bash] [--runs 5] [--scale 1]
+ *                [--only workload] [--out results.tsv]
+ *
+ * bshell only understands a subset of the sh grammar (no variables, no
+ * redirections of fd 2), so the workloads are written in that subset.
+ * Where the shells differ (bshell has "status", sh has "wait"), the workload
+ * has a separate epilogue per shell.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#define MAX_SHELLS 8
+#define MAX_RUNS 101
+
+typedef struct {
+    const char *name;   /* column "shell" */
+    const char *path;
+    int is_bshell;
+} Shell;
+
+typedef struct {
+    double wall_ms;
+    double user_ms;
+    double sys_ms;
+    long csw;           /* nvcsw + nivcsw */
+    long maxrss_kb;
+    int status;
+} Sample;
+
+typedef struct {
+    const char *name;
+    const char *description;
+    void (*generate)(FILE *out, long scale, long arg, int is_bshell);
+    long arg;           /* workload parameter, e.g. number of pipeline stages */
+    long mbytes;        /* data pushed through pipes (parsed, for parse_only) per scale unit, 0 = none */
+    long ops;           /* operations (spawns, commands, ...) per scale unit for ops_s/us_op, 0 = none */
+    long heap_mb;       /* shell heap inflated to this size before the script runs, 0 = none */
+    int parse_only;     /* run the shells with -n: parse the script, execute nothing */
+} Workload;
+
+/* ---- workloads --------------------------------------------------------- */
+
+/* N sequential `true` (a builtin in all three shells) */
+static void gen_true_seq(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < 20000 * scale; i++)
+        fputs("true\n", out);
+}
+
+/* N sequential /bin/true: one process creation per line */
+static void gen_spawn_seq(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < 1000 * scale; i++)
+        fputs("/bin/true\n", out);
+}
+
+/*
+ * N x /bin/true with an inflated shell heap of <heap_mb>: with fork the page
+ * tables of the whole heap would be copied for every start, posix_spawn (vfork)
+ * should be as fast as in spawn_seq. The heap of dash and bash is inflated by a
+ * variable; bshell has none and gets --inflate-heap instead (run_once()).
+ */
+static void heap_prologue(FILE *out, long heap_mb, int is_bshell) {
+    if (!is_bshell && heap_mb > 0)
+        fprintf(out, "x=$(/usr/bin/head -c %ld /dev/zero | /usr/bin/tr '\\0' x)\n", heap_mb << 20);
+}
+
+static void gen_spawn_rss(FILE *out, long scale, long arg, int is_bshell) {
+    heap_prologue(out, arg, is_bshell);
+    for (long i = 0; i < 1000 * scale; i++)
+        fputs("/bin/true\n", out);
+}
+
+/* long cat | cat | ... pipelines, /bin/cat so that the cat builtin does not replace the processes */
+static void gen_pipeline(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < 20 * scale; i++) {
+        fputs("echo pipeline", out);
+        for (int j = 0; j < 32; j++)
+            fputs(" | /bin/cat", out);
+        fputs(" > /dev/null\n", out);
+    }
+}
+
+/* wide && and || chains of builtins */
+static void gen_and_or(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < 200 * scale; i++) {
+        fputs("true", out);
+        for (int j = 0; j < 50; j++)
+            fputs(" && true", out);
+        fputs("\nfalse", out);
+        for (int j = 0; j < 49; j++)
+            fputs(" || false", out);
+        fputs(" || true\n", out);
+    }
+}
+
+/* ; && || mixed in one line: precedence and short-circuit jumps, builtins only */
+static void gen_mixed_ops(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < 2000 * scale; i++)
+        fputs("true && false || true ; false || true && true ; false && true && true || true\n", out);
+}
+
+/*
+ * A script of PARSE_MB MiB for the parse_only workload (all shells with -n):
+ * pipelines, redirections, quotes, && / ||, if/elif/else, while and
+ * here-documents, so mb_s is the parser and lexer throughput.
+ */
+#define PARSE_MB 16
+
+static void gen_parse_script(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; ftell(out) < ((long)PARSE_MB << 20) * scale; i++) {
+        fprintf(out, "ls -l /tmp/dir%ld | sort -k2,2n -t: | head -n 3 > /tmp/out%ld.txt\n", i, i);
+        fputs("test -f /etc/hosts && echo \"found the hosts file\" || echo \"no hosts; retry | later\"\n", out);
+        fputs("if test -d /tmp; then cd /tmp; elif true; then pwd; else echo none; fi\n", out);
+        fputs("while false; do echo never; done < /dev/null >> /tmp/log.txt\n", out);
+        fprintf(out, "cat <<END\nhere-document line %ld with <redirections> | pipes & ampersands\nEND\n", i);
+        fputs("/bin/echo arg1 arg2 arg3 arg4 arg5 arg6 arg7 arg8 arg9 arg10 arg11 arg12 > /dev/null\n", out);
+    }
+}
+
+/* a 10000-line script of builtins only (test, [, printf, cd, true): commands/sec without process starts */
+static void gen_builtin_mix(FILE *out, long scale, long arg, int is_bshell) {
+    static const char *lines[] = {
+        "test -d /tmp\n",
+        "printf \"%s %d\\n\" word 42\n",
+        "cd /tmp\n",
+        "[ -f /etc/passwd ]\n",
+        "true\n",
+        "cd /\n",
+        "test abc = abc\n",
+        "printf \"%s\\n\" a b c\n",
+    };
+    for (long i = 0; i < 10000 * scale; i++)
+        fputs(lines[i % (sizeof(lines) / sizeof(lines[0]))], out);
+}
+
+/*
+ * many background jobs, then the job table is queried. background_50k starts
+ * 50000 of them, so the reaping of finished jobs (and the job table) shows up:
+ * its us_op is start plus reap per job, compare with spawn_seq for the reap.
+ * dash and bash reap non-interactively only in jobs/wait, without the jobs
+ * every 1000 lines they run out of processes; bshell reaps on its own.
+ */
+static void gen_background(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < arg * scale; i++) {
+        fputs("/bin/true &\n", out);
+        if (!is_bshell && i % 1000 == 999)
+            fputs("jobs > /dev/null\n", out);
+    }
+    fputs(is_bshell ? "status > /dev/null\n" : "jobs > /dev/null\nwait\n", out);
+}
+
+/*
+ * argv lines of <arg> arguments for a builtin (parser only). Every workload of
+ * the series passes ARGV_TOTAL arguments in all, so with linear parsing wall_ms
+ * stays about the same from argv_parse_10 to argv_parse_100k; only the short
+ * lines add the per-line cost on top.
+ */
+#define ARGV_TOTAL 500000
+
+static void gen_argv_parse(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < ARGV_TOTAL / arg * scale; i++) {
+        fputs("true", out);
+        for (long j = 0; j < arg; j++)
+            fprintf(out, " arg%ld", j);
+        fputs("\n", out);
+    }
+}
+
+/* long argv lines passed to a new process */
+static void gen_argv_exec(FILE *out, long scale, long arg, int is_bshell) {
+    for (long i = 0; i < 20 * scale; i++) {
+        fputs("/bin/true", out);
+        for (int j = 0; j < 10000; j++)
+            fprintf(out, " file%05d.txt", j);
+        fputs("\n", out);
+    }
+}
+
+/*
+ * pipeline setup: <arg> x /bin/true connected by pipes. The stages do no work,
+ * so the time is dominated by creating the pipes and processes. Fewer
+ * repetitions for longer pipelines keep the total time per workload similar.
+ */
+static void gen_pipe_setup(FILE *out, long scale, long arg, int is_bshell) {
+    long reps = 2000 / arg > 0 ? 2000 / arg : 1;
+    for (long i = 0; i < reps * scale; i++) {
+        fputs("/bin/true", out);
+        for (long j = 1; j < arg; j++)
+            fputs(" | /bin/true", out);
+        fputs("\n", out);
+    }
+}
+
+/*
+ * pipe throughput: 256 MiB through head | cat | cat. bshell sets the pipe
+ * buffer size to <arg> bytes with the pipesize prefix; the other shells always
+ * use the kernel default (64 KiB) and serve as the reference.
+ */
+#define THROUGHPUT_MB 256
+
+static void gen_pipe_throughput(FILE *out, long scale, long arg, int is_bshell) {
+    if (is_bshell && arg > 0)
+        fprintf(out, "pipesize %ld ", arg);
+    fprintf(out, "/usr/bin/head -c %ld /dev/zero | /bin/cat | /bin/cat > /dev/null\n",
+            (long)THROUGHPUT_MB * 1024 * 1024 * scale);
+}
+
+/*
+ * zero-copy builtins: a THROUGHPUT_MB MiB file read with cat. In bshell cat and
+ * tee are builtins (splice/tee/copy_file_range); the other shells run
+ * coreutils, which is the reference. The file is created once per bench run.
+ */
+static char data_path[64];
+static char copy_path[64];
+
+static const char *data_file(long scale) {
+    static char block[1 << 20];
+    FILE *f;
+
+    if (access(data_path, R_OK) == 0)
+        return data_path;
+    // real data, not a sparse file: otherwise reading it would cost nothing
+    for (size_t i = 0; i < sizeof(block); i++)
+        block[i] = (char)(i * 2654435761u >> 13);
+    if ((f = fopen(data_path, "w")) == NULL) {
+        perror(data_path);
+        exit(1);
+    }
+    for (long i = 0; i < THROUGHPUT_MB * scale; i++)
+        fwrite(block, 1, sizeof(block), f);
+    fclose(f);
+    return data_path;
+}
+
+static void gen_cat_pipe(FILE *out, long scale, long arg, int is_bshell) {
+    fprintf(out, "cat %s | cat | cat > /dev/null\n", data_file(scale));
+}
+
+static void gen_cat_copy(FILE *out, long scale, long arg, int is_bshell) {
+    fprintf(out, "cat %s > %s\n", data_file(scale), copy_path);
+}
+
+static void gen_tee_file(FILE *out, long scale, long arg, int is_bshell) {
+    fprintf(out, "cat %s | tee %s > /dev/null\n", data_file(scale), copy_path);
+}
+
+/*
+ * while loop of builtins. bshell has no variables to count with, so the loop
+ * walks down a chain of LOOP_DEPTH nested directories with "test -d d" and
+ * "cd d" (builtins in all shells) until the bottom. The chain is created once
+ * per bench run; LOOP_LINES lines x LOOP_DEPTH iterations = 1M iterations, each
+ * line parsed once. The chain is kept short because the cost of cd in dash and
+ * bash grows with the length of the path.
+ */
+#define LOOP_DEPTH 100
+#define LOOP_LINES 10000
+
+static char chain_path[64];
+
+static const char *loop_chain(void) {
+    int fd, next;
+
+    if (access(chain_path, X_OK) == 0)
+        return chain_path;
+    if (mkdir(chain_path, 0755) < 0 || (fd = open(chain_path, O_RDONLY | O_DIRECTORY)) < 0) {
+        perror(chain_path);
+        exit(1);
+    }
+    // relative to the previous level, like the walk of the workload
+    for (int i = 0; i < LOOP_DEPTH; i++) {
+        if (mkdirat(fd, "d", 0755) < 0 || (next = openat(fd, "d", O_RDONLY | O_DIRECTORY)) < 0) {
+            perror("bench: loop chain");
+            exit(1);
+        }
+        close(fd);
+        fd = next;
+    }
+    close(fd);
+    return chain_path;
+}
+
+static void remove_chain(void) {
+    int fds[LOOP_DEPTH + 1];
+    int depth = 0;
+
+    if ((fds[0] = open(chain_path, O_RDONLY | O_DIRECTORY)) < 0)
+        return;
+    while (depth < LOOP_DEPTH && (fds[depth + 1] = openat(fds[depth], "d", O_RDONLY | O_DIRECTORY)) >= 0)
+        depth++;
+    for (; depth > 0; depth--) {
+        close(fds[depth]);
+        unlinkat(fds[depth - 1], "d", AT_REMOVEDIR);
+    }
+    close(fds[0]);
+    rmdir(chain_path);
+}
+
+static void gen_while_loop(FILE *out, long scale, long arg, int is_bshell) {
+    const char *chain = loop_chain();
+    for (long i = 0; i < LOOP_LINES * scale; i++)
+        fprintf(out, "cd %s ; while test -d d; do cd d; done\n", chain);
+}
+
+static const Workload workloads[] = {
+    { "true_seq",   "20000 x true (builtin)",                 gen_true_seq },
+    { "spawn_seq",  "1000 x /bin/true",                       gen_spawn_seq, 0, 0, 1000 },
+    { "spawn_rss_10m", "1000 x /bin/true, 10 MiB shell heap", gen_spawn_rss, 10, 0, 1000, 10 },
+    { "spawn_rss_100m", "1000 x /bin/true, 100 MiB shell heap", gen_spawn_rss, 100, 0, 1000, 100 },
+    { "spawn_rss_1g", "1000 x /bin/true, 1 GiB shell heap",   gen_spawn_rss, 1024, 0, 1000, 1024 },
+    { "pipeline",   "20 x echo | 32 x /bin/cat",              gen_pipeline },
+    { "and_or",     "200 x 50-wide && chain and || chain",    gen_and_or },
+    { "mixed_ops",  "2000 x mixed ; && || line (builtins)",   gen_mixed_ops },
+    { "while_1m",   "10000 x 100-iteration while test; do cd", gen_while_loop },
+    { "parse_only", "16 MiB script parsed with -n",           gen_parse_script, 0, PARSE_MB, 0, 0, 1 },
+    { "builtin_mix", "10000 lines of test/printf/cd/true",    gen_builtin_mix, 0, 0, 10000 },
+    { "background", "500 x /bin/true & then status/wait",     gen_background, 500, 0, 500 },
+    { "background_50k", "50000 x /bin/true & then status/wait", gen_background, 50000, 0, 50000 },
+    { "argv_parse_10", "50000 x true with 10 arguments",      gen_argv_parse, 10 },
+    { "argv_parse_100", "5000 x true with 100 arguments",     gen_argv_parse, 100 },
+    { "argv_parse_1k", "500 x true with 1000 arguments",      gen_argv_parse, 1000 },
+    { "argv_parse_10k", "50 x true with 10000 arguments",     gen_argv_parse, 10000 },
+    { "argv_parse_100k", "5 x true with 100000 arguments",    gen_argv_parse, 100000 },
+    { "argv_exec",  "20 x /bin/true with 10000 arguments",    gen_argv_exec },
+    { "pipe_2",     "1000 x 2-stage /bin/true pipeline",      gen_pipe_setup, 2 },
+    { "pipe_10",    "200 x 10-stage /bin/true pipeline",      gen_pipe_setup, 10 },
+    { "pipe_100",   "20 x 100-stage /bin/true pipeline",      gen_pipe_setup, 100 },
+    { "pipe_1000",  "2 x 1000-stage /bin/true pipeline",      gen_pipe_setup, 1000 },
+    { "pipe_5000",  "1 x 5000-stage /bin/true pipeline",      gen_pipe_setup, 5000 },
+    { "pipesz_64k", "256 MiB through 3 stages, 64 KiB pipes", gen_pipe_throughput, 65536, THROUGHPUT_MB },
+    { "pipesz_256k", "256 MiB through 3 stages, 256 KiB pipes", gen_pipe_throughput, 262144, THROUGHPUT_MB },
+    { "pipesz_1m",  "256 MiB through 3 stages, 1 MiB pipes",  gen_pipe_throughput, 1048576, THROUGHPUT_MB },
+    { "cat_pipe",   "256 MiB file through cat | cat | cat",   gen_cat_pipe, 0, THROUGHPUT_MB },
+    { "cat_copy",   "256 MiB file copied with cat > file",    gen_cat_copy, 0, THROUGHPUT_MB },
+    { "tee_file",   "256 MiB file through cat | tee file",    gen_tee_file, 0, THROUGHPUT_MB },
+};
+#define WORKLOAD_COUNT (sizeof(workloads) / sizeof(workloads[0]))
+
+/* ---- measurement ------------------------------------------------------- */
+
+static double timespec_ms(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) * 1000.0 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+static double timeval_ms(const struct timeval *tv) {
+    return tv->tv_sec * 1000.0 + tv->tv_usec / 1000.0;
+}
+
+/*
+ * runs <shell> <script> with stdin/stdout on /dev/null, stderr kept; bshell gets
+ * --inflate-heap=<heap_mb>, all shells get -n for parse_only workloads
+ */
+static int run_once(const Shell *shell, const Workload *workload, const char *script, Sample *sample) {
+    struct timespec start, end;
+    struct rusage ru;
+    char option[64];
+    char *args[5];
+    int argn = 0;
+    int status;
+    pid_t pid;
+
+    args[argn++] = (char *)shell->path;
+    if (shell->is_bshell && workload->heap_mb > 0) {
+        snprintf(option, sizeof(option), "--inflate-heap=%ld", workload->heap_mb);
+        args[argn++] = option;
+    }
+    if (workload->parse_only)
+        args[argn++] = "-n";
+    args[argn++] = (char *)script;
+    args[argn] = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        execv(shell->path, args);
+        fprintf(stderr, "bench: %s: %s\n", shell->path, strerror(errno));
+        _exit(127);
+    }
+    while (wait4(pid, &status, 0, &ru) < 0) {
+        if (errno != EINTR) {
+            perror("wait4");
+            return -1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    sample->wall_ms = timespec_ms(&start, &end);
+    sample->user_ms = timeval_ms(&ru.ru_utime);
+    sample->sys_ms = timeval_ms(&ru.ru_stime);
+    sample->csw = ru.ru_nvcsw + ru.ru_nivcsw;
+    sample->maxrss_kb = ru.ru_maxrss;
+    sample->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+/* median of every column on its own */
+static Sample median(Sample *samples, int n) {
+    double d[MAX_RUNS];
+    long l[MAX_RUNS];
+    Sample m;
+
+#define MEDIAN_OF(field, arr, cmp) \
+    for (int i = 0; i < n; i++) arr[i] = samples[i].field; \
+    qsort(arr, n, sizeof(arr[0]), cmp); \
+    m.field = arr[n / 2];
+
+    MEDIAN_OF(wall_ms, d, cmp_double)
+    MEDIAN_OF(user_ms, d, cmp_double)
+    MEDIAN_OF(sys_ms, d, cmp_double)
+    MEDIAN_OF(csw, l, cmp_long)
+    MEDIAN_OF(maxrss_kb, l, cmp_long)
+#undef MEDIAN_OF
+    /* a non-zero exit status in any run is reported */
+    m.status = 0;
+    for (int i = 0; i < n; i++)
+        if (samples[i].status != 0) m.status = samples[i].status;
+    return m;
+}
+
+/* ---- main -------------------------------------------------------------- */
+
+/* looks up <name> in PATH, returns a malloc'd path or NULL */
+static char * find_in_path(const char *name) {
+    const char *path = getenv("PATH");
+    if (strchr(name, '/') != NULL)
+        return access(name, X_OK) == 0 ? strdup(name) : NULL;
+    if (path == NULL) path = "/usr/bin:/bin";
+
+    while (*path) {
+        const char *end = strchr(path, ':');
+        size_t len = end ? (size_t)(end - path) : strlen(path);
+        char *candidate;
+        if (asprintf(&candidate, "%.*s/%s", (int)len, len ? path : ".", name) < 0)
+            return NULL;
+        if (access(candidate, X_OK) == 0)
+            return candidate;
+        free(candidate);
+        path += len;
+        if (*path == ':') path++;
+    }
+    return NULL;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s --shell PATH [--compare dash,bash] [--runs N] [--scale N]\n"
+            "          [--only WORKLOAD] [--out FILE] [--list]\n", name);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    const char *bshell = NULL;
+    const char *compare = "dash,bash";
+    const char *only = NULL;
+    const char *out_path = NULL;
+    int runs = 5;
+    long scale = 1;
+    Shell shells[MAX_SHELLS];
+    int shell_count = 0;
+    char dir[] = "/tmp/bshell-bench-XXXXXX";
+    FILE *out = stdout;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0) {
+            for (size_t w = 0; w < WORKLOAD_COUNT; w++)
+                printf("%-12s %s\n", workloads[w].name, workloads[w].description);
+            return 0;
+        }
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "--shell") == 0) bshell = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0) compare = argv[++i];
+        else if (strcmp(argv[i], "--runs") == 0) runs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--scale") == 0) scale = atol(argv[++i]);
+        else if (strcmp(argv[i], "--only") == 0) only = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0) out_path = argv[++i];
+        else usage(argv[0]);
+    }
+    if (bshell == NULL || runs < 1 || runs > MAX_RUNS || scale < 1) usage(argv[0]);
+
+    shells[shell_count++] = (Shell){ "bshell", bshell, 1 };
+    char *list = strdup(compare);
+    for (char *save, *name = strtok_r(list, ",", &save); name != NULL && shell_count < MAX_SHELLS;
+         name = strtok_r(NULL, ",", &save)) {
+        char *path = find_in_path(name);
+        if (path == NULL) {
+            fprintf(stderr, "bench: %s not installed, skipped\n", name);
+            continue;
+        }
+        shells[shell_count++] = (Shell){ name, path, 0 };
+    }
+
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(data_path, sizeof(data_path), "%s/data", dir);
+    snprintf(copy_path, sizeof(copy_path), "%s/copy", dir);
+    snprintf(chain_path, sizeof(chain_path), "%s/chain", dir);
+    if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+        perror(out_path);
+        return 1;
+    }
+
+    fprintf(out, "workload\tshell\truns\twall_ms\tuser_ms\tsys_ms\tcsw\tmaxrss_kb\tstatus\tmb_s\tcsw_per_gb\tops_s\tus_op\n");
+    for (size_t w = 0; w < WORKLOAD_COUNT; w++) {
+        if (only != NULL && strcmp(only, workloads[w].name) != 0)
+            continue;
+
+        for (int s = 0; s < shell_count; s++) {
+            char script[sizeof(dir) + 64];
+            Sample samples[MAX_RUNS];
+            FILE *f;
+
+            snprintf(script, sizeof(script), "%s/%s.%s", dir, workloads[w].name, shells[s].name);
+            if ((f = fopen(script, "w")) == NULL) {
+                perror(script);
+                return 1;
+            }
+            workloads[w].generate(f, scale, workloads[w].arg, shells[s].is_bshell);
+            fclose(f);
+
+            int n = 0;
+            for (int r = 0; r < runs; r++)
+                if (run_once(&shells[s], &workloads[w], script, &samples[n]) == 0) n++;
+            unlink(script);
+            if (n == 0) continue;
+
+            // Start with an inflated heap: measured alone and taken off for ops_s/us_op
+            double base_ms = 0;
+            if (workloads[w].heap_mb > 0) {
+                Sample base[MAX_RUNS];
+                int nb = 0;
+                if ((f = fopen(script, "w")) == NULL) {
+                    perror(script);
+                    return 1;
+                }
+                heap_prologue(f, workloads[w].heap_mb, shells[s].is_bshell);
+                fclose(f);
+                for (int r = 0; r < runs; r++)
+                    if (run_once(&shells[s], &workloads[w], script, &base[nb]) == 0) nb++;
+                unlink(script);
+                if (nb > 0)
+                    base_ms = median(base, nb).wall_ms;
+            }
+
+            Sample m = median(samples, n);
+            double mb = (double)workloads[w].mbytes * scale;
+            fprintf(out, "%s\t%s\t%d\t%.2f\t%.2f\t%.2f\t%ld\t%ld\t%d",
+                    workloads[w].name, shells[s].name, n, m.wall_ms, m.user_ms, m.sys_ms,
+                    m.csw, m.maxrss_kb, m.status);
+            if (mb > 0)
+                fprintf(out, "\t%.1f\t%.0f", mb / (m.wall_ms / 1000.0), m.csw / (mb / 1024.0));
+            else
+                fprintf(out, "\t-\t-");
+            double ops = (double)workloads[w].ops * scale;
+            double op_ms = m.wall_ms - base_ms;
+            if (ops > 0 && op_ms > 0)
+                fprintf(out, "\t%.0f\t%.2f\n", ops / (op_ms / 1000.0), op_ms * 1000.0 / ops);
+            else
+                fprintf(out, "\t-\t-\n");
+            fflush(out);
+        }
+    }
+
+    unlink(data_path);
+    unlink(copy_path);
+    remove_chain();
+    rmdir(dir);
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * lexdump.c
+ *
+ * Token dump for the differential lexer test (CMake target "lexer_diff").
+ * The same source is linked once with the flex scanner (src/tokenscanner.l)
+ * and once with the hand-written lexer (src/tokenlexer.c); both must produce
+ * the same token stream for the corpus (bench/lexer-corpus.sh):
+ *
+ *   lexdump FILE            one line per token: input line, token, flags and
+ *                           the text of its span (yy_token_base() + offset)
+ *   lexdump --bench FILE    tokens/sec over the corpus repeated in memory
+ *
+ * Span offsets are not compared: flex copies the tokens of a line into its
+ * own buffer, tokenlexer.c points into the input, so only text, length and
+ * flags of a span are the same. The dump feeds the input in small, changing
+ * chunk sizes, so tokens, quotes and here-documents also cross the refill
+ * boundaries of both lexers.
+ *
+ * Here-document bodies are read with yy_read_line() after the '\n' of their
+ * line, as the parser does (heredoc_read_bodies()), and dumped as BODY.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "command.h"
+#include "tokenparser.h"
+#include "readlineparsing.h"
+
+#define BENCH_MIN_BYTES (64L << 20)   /* the corpus is repeated up to this size */
+#define MAX_HEREDOCS 64
+
+YYSTYPE yylval;
+int yylex(void);
+
+static const char *input;
+static size_t input_len;
+static size_t input_pos;
+static int chunked;
+
+/* the scanners read through yy_input() (readlineparsing.h), here from memory */
+int yy_input(char *buf, int max_size) {
+    static const int chunks[] = { 1, 7, 2, 31, 5, 64, 3, 13, 250, 11 };
+    static int next = 0;
+    size_t n = input_len - input_pos;
+
+    if (chunked && n > (size_t)chunks[next])
+        n = chunks[next];
+    next = (next + 1) % (int)(sizeof(chunks) / sizeof(chunks[0]));
+    if (n > (size_t)max_size)
+        n = max_size;
+    memcpy(buf, input + input_pos, n);
+    input_pos += n;
+    return (int)n;
+}
+
+static const char *token_name(int token) {
+    static char buf[16];
+
+    switch (token) {
+        case AND: return "AND";
+        case OR: return "OR";
+        case APPEND: return "APPEND";
+        case HEREDOC: return "HEREDOC";
+        case HERESTRING: return "HERESTRING";
+        case PROCSUB_IN: return "PROCSUB_IN";
+        case PROCSUB_OUT: return "PROCSUB_OUT";
+        case IF: return "IF";
+        case THEN: return "THEN";
+        case ELIF: return "ELIF";
+        case ELSE: return "ELSE";
+        case FI: return "FI";
+        case WHILE: return "WHILE";
+        case DO: return "DO";
+        case DONE: return "DONE";
+        case STRING: return "STRING";
+        case UNDEF: return "UNDEF";
+        case '\n': return "NEWLINE";
+        default:
+            snprintf(buf, sizeof(buf), "'%c'", token);
+            return buf;
+    }
+}
+
+/* text with newlines, tabs and backslashes escaped, so that one token stays one line */
+static void print_text(const char *text, long len) {
+    for (long i = 0; i < len; i++) {
+        switch (text[i]) {
+            case '\n': fputs("\\n", stdout); break;
+            case '\t': fputs("\\t", stdout); break;
+            case '\\': fputs("\\\\", stdout); break;
+            default: putchar(text[i]); break;
+        }
+    }
+}
+
+static long count_newlines(const char *text, long len) {
+    long n = 0;
+    for (const char *p = text; (p = memchr(p, '\n', text + len - p)) != NULL; p++)
+        n++;
+    return n;
+}
+
+/*
+ * Runs the lexer to EOF. Returns the number of tokens (here-document lines
+ * included); with <dump> each of them is printed.
+ */
+static long lex_all(int dump) {
+    char *delims[MAX_HEREDOCS];
+    int ndelims = 0;
+    int after_heredoc = 0;
+    long line = 1;
+    long count = 0;
+    int token;
+
+    while ((token = yylex()) != 0) {
+        count++;
+        if (dump) {
+            printf("%ld\t%s", line, token_name(token));
+            if (token == STRING) {
+                printf("\t%d\t", yylval.span.flags);
+                print_text(yy_token_base() + yylval.span.offset, yylval.span.len);
+            } else if (token == UNDEF) {
+                printf("\t%d", yylval.ch);
+            }
+            putchar('\n');
+        }
+        // a quoted string may span lines
+        if (token == STRING)
+            line += count_newlines(yy_token_base() + yylval.span.offset, yylval.span.len);
+        // the word after << is the delimiter, its body follows the line
+        if (after_heredoc && token == STRING && ndelims < MAX_HEREDOCS)
+            delims[ndelims++] = strndup(yy_token_base() + yylval.span.offset, yylval.span.len);
+        after_heredoc = token == HEREDOC;
+        if (token != '\n')
+            continue;
+
+        line++;
+        for (int d = 0; d < ndelims; d++) {
+            char *body;
+            long len;
+            while ((len = yy_read_line(&body)) >= 0) {
+                line++;
+                count++;
+                if (dump) {
+                    printf("%ld\tBODY\t", line - 1);
+                    print_text(body, len);
+                    putchar('\n');
+                }
+                if ((size_t)len == strlen(delims[d]) && memcmp(body, delims[d], len) == 0)
+                    break;
+            }
+            free(delims[d]);
+        }
+        ndelims = 0;
+        yy_line_done();
+    }
+    return count;
+}
+
+static char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    char *data;
+    long size;
+
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0) {
+        perror(path);
+        exit(1);
+    }
+    rewind(f);
+    data = malloc(size + 1);
+    if (data == NULL || fread(data, 1, size, f) != (size_t)size) {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+    *len = size;
+    return data;
+}
+
+int main(int argc, char *argv[]) {
+    int bench = argc == 3 && strcmp(argv[1], "--bench") == 0;
+    struct timespec start, end;
+    size_t corpus_len;
+    char *corpus;
+
+    if (argc != 2 && !bench) {
+        fprintf(stderr, "usage: %s [--bench] corpus\n", argv[0]);
+        return 2;
+    }
+    corpus = read_file(argv[argc - 1], &corpus_len);
+    if (!bench) {
+        input = corpus;
+        input_len = corpus_len;
+        chunked = 1;
+        lex_all(1);
+        return 0;
+    }
+
+    // One long input: the lexers cannot be reset, and a single run amortizes the start
+    size_t copies = corpus_len > 0 ? BENCH_MIN_BYTES / corpus_len + 1 : 1;
+    char *big = malloc(copies * corpus_len);
+    if (big == NULL) {
+        perror("lexdump");
+        return 1;
+    }
+    for (size_t i = 0; i < copies; i++)
+        memcpy(big + i * corpus_len, corpus, corpus_len);
+    input = big;
+    input_len = copies * corpus_len;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long tokens = lex_all(0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s\t%ld tokens\t%.1f MB\t%.3f s\t%.0f tokens/s\t%.1f MB/s\n", argv[0], tokens,
+           input_len / 1e6, secs, tokens / secs, input_len / 1e6 / secs);
+    return 0;
+}
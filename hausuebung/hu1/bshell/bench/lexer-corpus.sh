@@ -0,0 +1,76 @@
+# Corpus for the differential lexer test (lexdump.c, target lexer_diff).
+# It is only tokenized, never run. Every line exercises something both
+# scanners must agree on; keep it ending with a newline.
+ls -l /tmp
+echo hello world; echo again
+/bin/true && /bin/false || echo fallback
+a|b||c&d&&e;f
+cat < in.txt > out.txt >> log.txt
+cat<in.txt>out.txt>>log.txt
+sort -k2,2n -t: /etc/passwd | head -n 3 > sorted.txt
+echo "quoted string" "with  two  blanks" "a;b|c&d<e>f"
+echo "if" "then" "while" "done"
+echo "multi
+line quote"
+echo "" the-second-quote-opens-a-string"
+echo 'single quotes are undef' `backticks` {braces} $dollar ~tilde
+printf "%s\n" [ ] = ! -eq -ne test -f /etc/hosts
+[ -d /tmp ] && test ! -e /nonexistent
+word_with.dots-and+plus*star#hash^caret,comma:colon~tilde$dollar%percent@at?question=equals!bang
+a-word-that-is-longer-than-sixteen-bytes-and-longer-than-thirty-two-bytes-to-cover-the-simd-loops/and/its/tail
+x0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef
+	tab	separated	words
+   leading and trailing blanks
+cat <<END
+body line one
+  if then else fi while do done
+END
+cat <<"QUOTED" | wc -l
+body with "quotes" and <redirections> | pipes & ampersands
+QUOTED
+cat <<A <<B
+first body
+A
+second body
+B
+if true; then cat <<IN; fi
+body inside if
+IN
+tr a-z A-Z <<< "here string"
+tr a-z A-Z<<<word
+diff <(sort a.txt) <(sort b.txt)
+tee >(wc -c) >(md5sum) < data.bin > /dev/null
+cat < <(ls)
+paste <(cut -f1 f) <(cut -f2 f)>joined
+if true; then echo yes; fi
+if false; then echo no; elif true; then echo elif; else echo else; fi
+if test -f x
+then
+    echo x
+elif test -f y
+then
+    echo y
+else
+    echo none
+fi
+while test -d d; do cd d; done
+while false
+do
+    echo never
+done > out.txt
+echo if then elif else fi while do done
+ls if; ls then; ls fi
+true && if true; then echo nested; fi
+true || while false; do true; done
+echo x | if true; then cat; fi
+( cd /tmp; ls ) > listing.txt
+(echo a; echo b)|cat
+((nested))
+fi done then
+iff thenn dowhile done2 fiddle
+time ls -la
+run --cpus=0-3 --policy=batch --nice=10 -- make -j4
+xargs -0 -P 4 -n 100 rm -f
+echo ends-with-semicolon;
+echo tokens;after;semicolons
+echo a&echo b&
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "arena.h"
+#include "debug.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+Arena parse_arena = { NULL, NULL, 0, 0, 0 };
+
+static ArenaBlock * block_new(Arena *arena, size_t size) {
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + size);
+    if (block == NULL) {
+        perror("arena");
+        exit(1);
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    arena->block_mallocs++;
+    return block;
+}
+
+void * arena_alloc(Arena *arena, size_t size) {
+    ArenaBlock *block = arena->current;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    arena->allocations++;
+    arena->bytes += size;
+
+    if (block == NULL) {
+        block = block_new(arena, size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+        arena->first = arena->current = block;
+    }
+
+    while (block->size - block->used < size) {
+        // Nächsten, schon vorhandenen Block wiederverwenden oder einen neuen einhängen
+        ArenaBlock *next = block->next;
+        if (next == NULL || next->size < size) {
+            ArenaBlock *fresh = block_new(arena, size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+            fresh->next = next;
+            block->next = fresh;
+            next = fresh;
+        }
+        next->used = 0;
+        block = arena->current = next;
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void * arena_calloc(Arena *arena, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        fprintf(stderr, "arena: allocation too large\n");
+        exit(1);
+    }
+    void *ptr = arena_alloc(arena, count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+char * arena_strndup(Arena *arena, const char *str, size_t len) {
+    char *copy = arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/*
+ * O(1): nur der Zeiger springt zurück auf den ersten Block. Weitere Blöcke
+ * werden erst beim Weiterschalten in arena_alloc() zurückgesetzt.
+ */
+void arena_reset(Arena *arena) {
+    if (arena->first != NULL) {
+        arena->first->used = 0;
+    }
+    arena->current = arena->first;
+    arena->allocations = 0;
+    arena->bytes = 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * arena.h
+ *
+ * Einfacher Bump-Allocator. Alles, was der Parser für eine Eingabezeile anlegt
+ * (Tokens, Listen, SimpleCommand, Redirection), kommt aus parse_arena und wird
+ * nach execute() mit einem einzigen arena_reset() freigegeben.
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;   // nutzbare Bytes in data
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *first;
+    ArenaBlock *current;
+    size_t allocations;   // Anzahl arena_alloc-Aufrufe seit dem letzten Reset
+    size_t bytes;         // angeforderte Bytes seit dem letzten Reset
+    size_t block_mallocs; // malloc-Aufrufe für neue Blöcke (insgesamt)
+} Arena;
+
+/* Arena für den Parsebaum der aktuellen Eingabezeile */
+extern Arena parse_arena;
+
+/* Liefert <size> Bytes (ausgerichtet für jeden Typ), nicht initialisiert */
+void * arena_alloc(Arena *arena, size_t size);
+
+/* Wie calloc, aber aus der Arena */
+void * arena_calloc(Arena *arena, size_t count, size_t size);
+
+/* Kopiert <len> Bytes von <str> und hängt ein '\0' an */
+char * arena_strndup(Arena *arena, const char *str, size_t len);
+
+/* Gibt alles auf einmal frei; die Blöcke bleiben für die nächste Zeile erhalten */
+void arena_reset(Arena *arena);
+
+#endif /* ARENA_H */
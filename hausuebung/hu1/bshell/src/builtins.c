@@ -0,0 +1,595 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "command.h"
+#include "builtins.h"
+#include "launcher.h"
+#include "pathcache.h"
+#include "statuslist.h"
+#include "eventloop.h"
+#include "jobserver.h"
+#include "xargs.h"
+#include "zerocopy.h"
+#include "execute.h"
+#include "shell.h"
+#include "debug.h"
+
+/* do not modify this */
+#ifndef NOLIBREADLINE
+#include <readline/history.h>
+#endif /* NOLIBREADLINE */
+
+/*
+ * Wenn der Benutzer "exit" eingibt, Shell sofort verlassen (optional mit Exit-Code).
+ * Keine Zahl: Meldung und Exit-Code 2 wie in der bash (atoi machte daraus 0).
+ */
+static int builtin_exit(char ** command){
+    char *end;
+    long code = 0;
+
+    if (command[1] != NULL) {
+        code = strtol(command[1], &end, 10);
+        if (end == command[1] || *end != '\0') {
+            fprintf(stderr, "-bshell: exit: %s: numeric argument required\n", command[1]);
+            exit(2);
+        }
+    }
+    exit(code & 0xff);
+}
+
+static int builtin_cd(char ** command){
+    char *path = command[1];  // Pfadparameter lesen
+
+    if (path == NULL) { // Wenn kein Argument übergeben wurde (z. B. nur "cd"), HOME verwenden
+        path = getenv("HOME");
+    }
+
+    // Prüfen, ob Pfad gültig ist
+    if (path == NULL || strlen(path) == 0) {
+        fprintf(stderr, "cd: invalid path\n");
+        return 1;
+    }
+
+    if (chdir(path) != 0) {
+        perror("cd");
+        return 1;
+    }
+    return 0;
+}
+
+/* do not modify this */
+#ifndef NOLIBREADLINE
+static int builtin_hist(char ** command){ // Zeigt die bisherigen Befehle an, wenn "hist" eingegeben wird.
+    register HIST_ENTRY **the_list;
+    register int i;
+    printf("--- History --- \n");
+
+    the_list = history_list ();
+    if (the_list)
+        for (i = 0; the_list[i]; i++)
+            printf ("%d: %s\n", i + history_base, the_list[i]->line);
+    else {
+        printf("history could not be found!\n");
+    }
+
+    printf("--------------- \n");
+    return 0;
+}
+#endif /*NOLIBREADLINE*/
+
+/*
+ * "status" listet die Prozesse, "status -v" zusätzlich Laufzeit, CPU-Zeit, RSS, Seitenfehler und Kontextwechsel.
+ * "status -r N" legt fest, wie viele beendete Jobs bis zur nächsten Ausgabe aufgehoben werden.
+ */
+static int builtin_status(char ** command){
+    int verbose = 0;
+    char *end;
+
+    for (int i = 1; command[i] != NULL; i++) {
+        if (strcmp(command[i], "-v") == 0) {
+            verbose = 1;
+        } else if (strcmp(command[i], "-r") == 0 && command[i + 1] != NULL) {
+            long n = strtol(command[++i], &end, 10);
+            if (*end != '\0' || n < 1 || n > 1000000 || statuslist_set_retention((int)n) < 0) {
+                fprintf(stderr, "status: %s: invalid retention\n", command[i]);
+                return 2;
+            }
+            return 0;
+        } else {
+            fprintf(stderr, "status: usage: status [-v] | status -r N\n");
+            return 2;
+        }
+    }
+    eventloop_reap();                // gerade beendete Kinder noch eintragen
+    statuslist_print_and_cleanup(verbose);  // Funktion in statuslist.c aufrufen
+    jobserver_print_stats();
+    return 0;
+}
+
+/* "pipesize N" setzt die Puffergröße neuer Pipes (0 = Vorgabe), "pipesize" zeigt sie */
+static int builtin_pipesize(char ** command){
+    long size;
+
+    if (command[1] == NULL) {
+        if (pipe_size == 0)
+            printf("pipe size: default\n");
+        else
+            printf("pipe size: %ld\n", pipe_size);
+        return 0;
+    }
+    size = pipe_size_parse(command[1]);
+    if (size < 0 || command[2] != NULL) {
+        fprintf(stderr, "pipesize: usage: pipesize [N[K|M]]\n");
+        return 2;
+    }
+    pipe_size = pipe_size_clamp(size);
+    if (pipe_size != size)
+        fprintf(stderr, "pipesize: limited to %ld (/proc/sys/fs/pipe-max-size)\n", pipe_size);
+    return 0;
+}
+
+/* "jobs -j N" begrenzt die gleichzeitigen Hintergrundjobs (0 = unbegrenzt), "jobs" zeigt die Grenze */
+static int builtin_jobs(char ** command){
+    char *end;
+
+    if (command[1] == NULL) {
+        if (jobserver_limit() == 0)
+            printf("job slots: unlimited\n");
+        else
+            printf("job slots: %d\n", jobserver_limit());
+        return 0;
+    }
+    if (strcmp(command[1], "-j") != 0 || command[2] == NULL || command[3] != NULL) {
+        fprintf(stderr, "jobs: usage: jobs [-j N]\n");
+        return 2;
+    }
+    long n = strtol(command[2], &end, 10);
+    if (*end != '\0' || n < 0 || n > 4096) {
+        fprintf(stderr, "jobs: %s: invalid number of slots\n", command[2]);
+        return 2;
+    }
+    return jobserver_set_limit((int)n) < 0 ? 1 : 0;
+}
+
+/* "hash" zeigt die aufgelösten Programme, "hash -r" leert die Tabelle, "hash name..." trägt Programme ein */
+static int builtin_hash(char ** command){
+    int res = 0;
+    if (command[1] == NULL) {
+        pathcache_print();
+        return 0;
+    }
+    if (strcmp(command[1], "-r") == 0) {
+        pathcache_clear();
+        return 0;
+    }
+    for (int i = 1; command[i] != NULL; i++) {
+        if (pathcache_lookup(command[i]) == NULL) {
+            fprintf(stderr, "-bshell: hash: %s: not found\n", command[i]);
+            res = 1;
+        }
+    }
+    return res;
+}
+
+static int builtin_true(char ** command){
+    return 0;
+}
+
+static int builtin_false(char ** command){
+    return 1;
+}
+
+/* echo [-n] args... */
+static int builtin_echo(char ** command){
+    int i = 1;
+    int newline = 1;
+    if (command[1] != NULL && strcmp(command[1], "-n") == 0) {
+        newline = 0;
+        i++;
+    }
+    for (int first = i; command[i] != NULL; i++) {
+        if (i > first) putchar(' ');
+        fputs(command[i], stdout);
+    }
+    if (newline) putchar('\n');
+    return 0;
+}
+
+static int builtin_pwd(char ** command){
+    char *cwd = getcwd(NULL, 0);
+    if (cwd == NULL) {
+        perror("pwd");
+        return 1;
+    }
+    puts(cwd);
+    free(cwd);
+    return 0;
+}
+
+/* ==== test / [ ==== */
+
+/* Rückgabe wie beim Prozess: 0 = wahr, 1 = falsch, 2 = Fehler */
+static int test_unary(const char *op, const char *arg) {
+    struct stat st;
+    if (strcmp(op, "-n") == 0) return arg[0] != '\0' ? 0 : 1;
+    if (strcmp(op, "-z") == 0) return arg[0] == '\0' ? 0 : 1;
+    if (strcmp(op, "-r") == 0) return access(arg, R_OK) == 0 ? 0 : 1;
+    if (strcmp(op, "-w") == 0) return access(arg, W_OK) == 0 ? 0 : 1;
+    if (strcmp(op, "-x") == 0) return access(arg, X_OK) == 0 ? 0 : 1;
+    if (strcmp(op, "-L") == 0 || strcmp(op, "-h") == 0)
+        return lstat(arg, &st) == 0 && S_ISLNK(st.st_mode) ? 0 : 1;
+
+    if (strlen(op) != 2 || op[0] != '-' || strchr("efdsp", op[1]) == NULL) {
+        fprintf(stderr, "test: %s: unary operator expected\n", op);
+        return 2;
+    }
+    if (stat(arg, &st) != 0) return 1;
+    switch (op[1]) {
+        case 'e': return 0;
+        case 'f': return S_ISREG(st.st_mode) ? 0 : 1;
+        case 'd': return S_ISDIR(st.st_mode) ? 0 : 1;
+        case 's': return st.st_size > 0 ? 0 : 1;
+        case 'p': return S_ISFIFO(st.st_mode) ? 0 : 1;
+    }
+    return 2;
+}
+
+static int test_integer(const char *s, long long *value) {
+    char *end;
+    *value = strtoll(s, &end, 10);
+    if (s[0] == '\0' || *end != '\0') {
+        fprintf(stderr, "test: %s: integer expression expected\n", s);
+        return -1;
+    }
+    return 0;
+}
+
+static int is_binary_op(const char *op) {
+    static const char *ops[] = { "=", "!=", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", NULL };
+    for (int i = 0; ops[i] != NULL; i++) {
+        if (strcmp(op, ops[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int test_binary(const char *a, const char *op, const char *b) {
+    long long x, y;
+    if (strcmp(op, "=") == 0) return strcmp(a, b) == 0 ? 0 : 1;
+    if (strcmp(op, "!=") == 0) return strcmp(a, b) != 0 ? 0 : 1;
+    if (test_integer(a, &x) < 0 || test_integer(b, &y) < 0) return 2;
+    if (strcmp(op, "-eq") == 0) return x == y ? 0 : 1;
+    if (strcmp(op, "-ne") == 0) return x != y ? 0 : 1;
+    if (strcmp(op, "-lt") == 0) return x < y ? 0 : 1;
+    if (strcmp(op, "-le") == 0) return x <= y ? 0 : 1;
+    if (strcmp(op, "-gt") == 0) return x > y ? 0 : 1;
+    return x >= y ? 0 : 1; // -ge
+}
+
+static int test_negate(int res) {
+    return res == 2 ? 2 : !res;
+}
+
+/* Auswertung nach Anzahl der Argumente wie in POSIX beschrieben */
+static int test_eval(int argc, char **argv) {
+    switch (argc) {
+        case 0:
+            return 1;
+        case 1:
+            return argv[0][0] != '\0' ? 0 : 1;
+        case 2:
+            if (strcmp(argv[0], "!") == 0) return test_negate(test_eval(1, argv + 1));
+            return test_unary(argv[0], argv[1]);
+        case 3:
+            if (is_binary_op(argv[1])) return test_binary(argv[0], argv[1], argv[2]);
+            if (strcmp(argv[0], "!") == 0) return test_negate(test_eval(2, argv + 1));
+            if (strcmp(argv[0], "(") == 0 && strcmp(argv[2], ")") == 0) return test_eval(1, argv + 1);
+            fprintf(stderr, "test: %s: binary operator expected\n", argv[1]);
+            return 2;
+        case 4:
+            if (strcmp(argv[0], "!") == 0) return test_negate(test_eval(3, argv + 1));
+            if (strcmp(argv[0], "(") == 0 && strcmp(argv[3], ")") == 0) return test_eval(2, argv + 1);
+            /* fall through */
+        default:
+            fprintf(stderr, "test: too many arguments\n");
+            return 2;
+    }
+}
+
+static int builtin_test(char ** command){
+    int argc = 0;
+    while (command[argc + 1] != NULL) argc++;
+
+    if (strcmp(command[0], "[") == 0) {
+        if (argc == 0 || strcmp(command[argc], "]") != 0) {
+            fprintf(stderr, "[: missing `]'\n");
+            return 2;
+        }
+        argc--;
+    }
+    return test_eval(argc, command + 1);
+}
+
+/* ==== printf ==== */
+
+/* Gibt die Escape-Sequenz ab *s aus und setzt *s hinter die Sequenz */
+static void printf_escape(const char **s) {
+    const char *p = *s + 1; // hinter dem Backslash
+    int value = 0;
+    switch (*p) {
+        case 'n': putchar('\n'); break;
+        case 't': putchar('\t'); break;
+        case 'r': putchar('\r'); break;
+        case 'a': putchar('\a'); break;
+        case 'b': putchar('\b'); break;
+        case 'f': putchar('\f'); break;
+        case 'v': putchar('\v'); break;
+        case '\\': putchar('\\'); break;
+        case '"': putchar('"'); break;
+        case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+            for (int n = 0; n < 3 && *p >= '0' && *p <= '7'; n++, p++) {
+                value = value * 8 + (*p - '0');
+            }
+            putchar(value);
+            *s = p;
+            return;
+        case '\0':
+            putchar('\\');
+            *s = p;
+            return;
+        default:
+            putchar('\\');
+            putchar(*p);
+            break;
+    }
+    *s = p + 1;
+}
+
+/*
+ * Gibt das Format einmal aus und verbraucht dabei Argumente aus *args.
+ * Rückgabe: Anzahl verbrauchter Argumente oder -1 bei ungültiger Direktive.
+ */
+static int printf_once(const char *fmt, char ***args) {
+    int consumed = 0;
+    const char *p = fmt;
+
+    while (*p) {
+        if (*p == '\\') {
+            printf_escape(&p);
+            continue;
+        }
+        if (*p != '%') {
+            putchar(*p++);
+            continue;
+        }
+        if (p[1] == '%') {
+            putchar('%');
+            p += 2;
+            continue;
+        }
+
+        // Direktive: %[flags][width][.precision]conversion
+        char spec[64];
+        size_t len = 0;
+        const char *start = p++;
+        p += strspn(p, "-+ #0");
+        p += strspn(p, "0123456789");
+        if (*p == '.') {
+            p++;
+            p += strspn(p, "0123456789");
+        }
+        if (*p == '\0' || strchr("diouxXcsfeEgG", *p) == NULL || (size_t)(p - start) > sizeof(spec) - 4) {
+            fprintf(stderr, "printf: %%%c: invalid directive\n", *p);
+            return -1;
+        }
+        len = p - start;
+        memcpy(spec, start, len);
+
+        char conversion = *p++;
+        const char *arg = "";
+        if (**args != NULL) {
+            arg = **args;
+            (*args)++;
+            consumed++;
+        }
+
+        switch (conversion) {
+            case 's':
+                spec[len++] = 's';
+                spec[len] = '\0';
+                printf(spec, arg);
+                break;
+            case 'c':
+                spec[len++] = 'c';
+                spec[len] = '\0';
+                printf(spec, arg[0]);
+                break;
+            case 'f': case 'e': case 'E': case 'g': case 'G':
+                spec[len++] = conversion;
+                spec[len] = '\0';
+                printf(spec, strtod(arg, NULL));
+                break;
+            default: // ganzzahlig
+                spec[len++] = 'l';
+                spec[len++] = 'l';
+                spec[len++] = conversion;
+                spec[len] = '\0';
+                printf(spec, strtoll(arg, NULL, 0));
+                break;
+        }
+    }
+    return consumed;
+}
+
+/* printf format [args...] – das Format wird wie in POSIX wiederholt, bis alle Argumente verbraucht sind */
+static int builtin_printf(char ** command){
+    if (command[1] == NULL) {
+        fprintf(stderr, "printf: usage: printf format [arguments]\n");
+        return 2;
+    }
+    char **args = command + 2;
+    int consumed;
+    do {
+        consumed = printf_once(command[1], &args);
+        if (consumed < 0) return 1;
+    } while (consumed > 0 && *args != NULL);
+    return 0;
+}
+
+/* Nach Namen sortiert, damit bsearch verwendet werden kann */
+static const Builtin builtins[] = {
+    { "[",      builtin_test   },
+    { "cat",    builtin_cat,   stage_cat, BUILTIN_PIPE_LAST, cat_accepts },
+    { "cd",     builtin_cd     },
+    { "echo",   builtin_echo   },
+    { "exit",   builtin_exit   },
+    { "false",  builtin_false  },
+    { "hash",   builtin_hash   },
+#ifndef NOLIBREADLINE
+    { "hist",   builtin_hist   },
+#endif /* NOLIBREADLINE */
+    { "jobs",   builtin_jobs   },
+    { "pipesize", builtin_pipesize },
+    { "printf", builtin_printf },
+    { "pwd",    builtin_pwd    },
+    { "status", builtin_status },
+    { "tee",    builtin_tee,   stage_tee, BUILTIN_PIPE_LAST, tee_accepts },
+    { "test",   builtin_test   },
+    { "true",   builtin_true   },
+    { "xargs",  builtin_xargs, NULL, BUILTIN_PIPE_LAST | BUILTIN_PIPE_EXEC },
+};
+
+static int builtin_compare(const void *key, const void *element) {
+    return strcmp((const char *)key, ((const Builtin *)element)->name);
+}
+
+const Builtin * builtin_lookup(const char *name) {
+    return bsearch(name, builtins, sizeof(builtins) / sizeof(builtins[0]), sizeof(Builtin), builtin_compare);
+}
+
+const Builtin * builtin_for(char **argv) {
+    const Builtin *builtin = builtin_lookup(argv[0]);
+
+    if (builtin != NULL && builtin->accepts != NULL && !builtin->accepts(argv))
+        return NULL;
+    return builtin;
+}
+
+/* Biegt <fd> auf <target> um und liefert eine Sicherung des alten fd (-1 = war geschlossen) */
+static int redirect_fd(int fd, int target) {
+    int saved = fcntl(target, F_DUPFD_CLOEXEC, 10);
+    dup2(fd, target);
+    close(fd);
+    return saved;
+}
+
+static void restore_fd(int saved, int target) {
+    if (saved < 0) {
+        close(target);
+        return;
+    }
+    dup2(saved, target);
+    close(saved);
+}
+
+int builtin_run(const Builtin *builtin, SimpleCommand *cmd_s) {
+    return builtin_run_input(builtin, cmd_s, -1);
+}
+
+int builtin_run_input(const Builtin *builtin, SimpleCommand *cmd_s, int input) {
+    int fd_in, fd_out;
+    int saved_in = -1, saved_out = -1;
+    int res;
+
+    if (cmd_s->redirections == NULL && input == -1) {
+        res = builtin->func(cmd_s->command_tokens);
+        fflush(stdout); // sonst überholen später gestartete Kinder die gepufferte Ausgabe
+        return res;
+    }
+
+    if (redirections_open(cmd_s, &fd_in, &fd_out) < 0) {
+        if (input != -1) close(input);
+        return 1;
+    }
+    // Eine Umleitung mit < gewinnt wie bei Programmen gegen die Pipe
+    if (fd_in == -1) {
+        fd_in = input;
+    } else if (input != -1) {
+        close(input);
+    }
+
+    fflush(stdout);
+    if (fd_in != -1) saved_in = redirect_fd(fd_in, STDIN_FILENO);
+    if (fd_out != -1) saved_out = redirect_fd(fd_out, STDOUT_FILENO);
+
+    res = builtin->func(cmd_s->command_tokens);
+
+    fflush(stdout);
+    if (fd_in != -1) restore_fd(saved_in, STDIN_FILENO);
+    if (fd_out != -1) restore_fd(saved_out, STDOUT_FILENO);
+
+    debug_print("[%s] %s -> %d\n", __func__, builtin->name, res);
+    return res;
+}
+
+extern int fdtty; // Terminal der Shell (shell.c)
+
+/* Schließt im Kind wie ein exec alle O_CLOEXEC-fds außer <keep> (Prozess-Substitutionen) */
+static void close_cloexec_fds(const int *keep, int keep_count) {
+    DIR *dir = opendir("/proc/self/fd");
+    struct dirent *entry;
+
+    if (dir == NULL)
+        return;
+    while ((entry = readdir(dir)) != NULL) {
+        int fd = atoi(entry->d_name);
+        int kept = fd <= STDERR_FILENO || fd == dirfd(dir);
+
+        for (int i = 0; i < keep_count && !kept; i++)
+            kept = keep[i] == fd;
+        if (!kept && (fcntl(fd, F_GETFD) & FD_CLOEXEC))
+            close(fd);
+    }
+    closedir(dir);
+}
+
+pid_t builtin_spawn(const Builtin *builtin, SimpleCommand *cmd_s, const SpawnOptions *opts) {
+    sigset_t none;
+    pid_t pid;
+
+    fflush(stdout); // sonst gibt das Kind den Puffer der Shell noch einmal aus
+    fflush(stderr);
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid > 0) {
+        // Auch im Elternprozess, damit die Gruppe vor give_terminal() existiert
+        if (shell_interactive)
+            setpgid(pid, opts->pgid != 0 ? opts->pgid : pid);
+        debug_print("[%s] forked %s as %d (pgid %d)\n", __func__, builtin->name, pid, opts->pgid);
+        return pid;
+    }
+
+    // Pipes der Shell laufen im Vordergrund: das Kind holt sich das Terminal selbst
+    // (SIGTTOU ist noch ignoriert), sonst hält es ein zu frühes read mit SIGTTIN an
+    if (shell_interactive) {
+        setpgid(0, opts->pgid);
+        tcsetpgrp(fdtty, getpgrp());
+    }
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+    if (opts->fd_in != -1) dup2(opts->fd_in, STDIN_FILENO);
+    if (opts->fd_out != -1) dup2(opts->fd_out, STDOUT_FILENO);
+    close_cloexec_fds(opts->keep_fds, opts->keep_count);
+    _exit(builtin_run(builtin, cmd_s) & 0xff);
+}
@@ -0,0 +1,63 @@
+/*
+ * builtins.h
+ *
+ * Befehle, die direkt im Shell-Prozess laufen (ohne Prozessstart).
+ *
+ */
+
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include "command.h"
+#include "launcher.h"
+
+/* Ein Builtin bekommt die Tokens (argv, NULL-terminiert) und liefert den Exit-Status */
+typedef int (*BuiltinFunc)(char **argv);
+
+/*
+ * Variante für eine Pipe-Stufe, die als Thread in der Shell läuft: arbeitet nur
+ * mit <fd_in>/<fd_out> statt STDIN/STDOUT und fasst keinen globalen Zustand an.
+ */
+typedef int (*StageFunc)(char **argv, int fd_in, int fd_out);
+
+/*
+ * Builtins in einer Pipe laufen in einem eigenen Kind (fork), damit z. B.
+ * "echo x | exit 3" oder "ls | cd /" die Shell nicht verändern. Ausnahmen:
+ */
+#define BUILTIN_PIPE_LAST 1 /* darf als letzte Stufe in der Shell selbst laufen (liest aus der Pipe) */
+#define BUILTIN_PIPE_EXEC 2 /* sonst das Programm starten statt fork (braucht die Ereignisschleife) */
+
+typedef struct {
+    const char *name;
+    BuiltinFunc func;
+    StageFunc stage;    /* NULL: mitten in einer Pipe läuft das Builtin im Kind */
+    int pipe_flags;     /* BUILTIN_PIPE_* */
+    int (*accepts)(char **argv); /* NULL oder 0 für argv: stattdessen das Programm starten */
+} Builtin;
+
+/* Sucht das Builtin zum Befehlsnamen, NULL wenn es keins gibt */
+const Builtin * builtin_lookup(const char *name);
+
+/* Wie builtin_lookup(), aber NULL, wenn nur das Programm die Optionen kennt (z. B. "cat -n") */
+const Builtin * builtin_for(char **argv);
+
+/*
+ * Führt das Builtin mit den Umleitungen des Befehls aus. STDIN/STDOUT werden
+ * dafür vorübergehend umgebogen und danach wiederhergestellt.
+ */
+int builtin_run(const Builtin *builtin, SimpleCommand *cmd_s);
+
+/*
+ * Wie builtin_run(), STDIN kommt aber aus <input> (z. B. Leseseite einer Pipe,
+ * -1 = unverändert). <input> wird dabei geschlossen.
+ */
+int builtin_run_input(const Builtin *builtin, SimpleCommand *cmd_s, int input);
+
+/*
+ * Führt das Builtin als Pipe-Stufe im Vordergrund in einem Kind (fork) aus: <opts> liefert die
+ * Pipe-Enden, die Prozessgruppe und die offen zu haltenden fds (path/run werden
+ * nicht benutzt). Rückgabe: pid des Kindes oder -1 (Fehlermeldung ausgegeben).
+ */
+pid_t builtin_spawn(const Builtin *builtin, SimpleCommand *cmd_s, const SpawnOptions *opts);
+
+#endif /* BUILTINS_H */
@@ -5,29 +5,87 @@
 #include "command.h"
 #include "list.h"
 #include "stringbuffer.h"
+#include "arena.h"
+#include "heredoc.h"
 
 #include "debug.h"
 
 
 // Erstellt ein leeres Kommando. Nützlich als "neutrale Basis", falls keine Tokens in einer Kommandozeile gefunden wurden.
 Command * command_new_empty(){
-	Command * cmd = malloc(sizeof(struct command));
+	Command * cmd = arena_alloc(&parse_arena, sizeof(struct command));
 	cmd->command_type=C_EMPTY;
 	cmd->command_sequence = NULL;
+	cmd->left = cmd->right = cmd->otherwise = NULL;
+	cmd->redirect = NULL;
 	return cmd;
 }
 
 
 // Fügt ein neues einfaches Kommando (s_cmd) am Anfang eines zusammengesetzten Kommandos (cmd) hinzu, z. B. eine Sequenz von Befehlen wie cmd1 ; cmd2 ; cmd3.
 Command * command_append(int type, SimpleCommand * s_cmd, Command * cmd){
-	List * lst = malloc(sizeof(List));
+	List * lst = arena_alloc(&parse_arena, sizeof(List));
 	lst->head=s_cmd;
 	lst->tail=cmd->command_sequence->command_list;
 	cmd->command_sequence->command_list_len++;
 	cmd->command_sequence->command_list=lst;
+	cmd->command_type=type; // aus einem C_SIMPLE wird so die Pipe
 	return cmd;
 }
 
+// Knoten für ";", "&&" und "||": der Parser baut sie linksassoziativ, "a && b || c" = OR(AND(a, b), c).
+Command * command_binary(int type, Command *left, Command *right){
+	Command * cmd = command_new_empty();
+	cmd->command_type=type;
+	cmd->left=left;
+	cmd->right=right;
+	return cmd;
+}
+
+// Gruppe "if ...; fi > datei": die Umleitungen hängen an einem einfachen Befehl ohne
+// Tokens, so werden sie wie alle anderen aufbereitet und geöffnet.
+Command * command_group(Command *body, List *redirections){
+	Command * cmd = command_new_empty();
+	cmd->command_type=C_GROUP;
+	cmd->left=body;
+	if (redirections != NULL)
+		cmd->redirect=simple_command_new(0, NULL, redirections, 0);
+	return cmd;
+}
+
+Command * command_subshell(Command *body, List *redirections){
+	Command * cmd = command_group(body, redirections);
+	cmd->command_type=C_SUBSHELL;
+	return cmd;
+}
+
+Command * command_if(Command *cond, Command *then_part, Command *else_part){
+	Command * cmd = command_new_empty();
+	cmd->command_type=C_IF;
+	cmd->left=cond;
+	cmd->right=then_part;
+	cmd->otherwise=else_part;
+	return cmd;
+}
+
+Command * command_while(Command *cond, Command *body){
+	Command * cmd = command_new_empty();
+	cmd->command_type=C_WHILE;
+	cmd->left=cond;
+	cmd->right=body;
+	return cmd;
+}
+
+// Präfixe wie time gelten für die ganze Zeile: "if time a; then ..." ist kein Präfix der Zeile
+SimpleCommand * command_first(Command *cmd){
+	while (cmd->command_type == C_SEQUENCE || cmd->command_type == C_AND
+	       || cmd->command_type == C_OR || cmd->command_type == C_GROUP || cmd->command_type == C_SUBSHELL) {
+		cmd = cmd->left;
+	}
+	if (cmd->command_type == C_EMPTY || cmd->command_type == C_IF || cmd->command_type == C_WHILE) return NULL;
+	return cmd->command_sequence->command_list->head;
+}
+
 
 /*
 Erstellt ein zusammengesetztes Kommando:
@@ -43,9 +101,14 @@ type = C_PIPE → beschreibt die Art der Verbindung zwischen den beiden Befehlen
 Die Funktion erstellt eine verkettete Liste: [cmd1] -> [cmd2]
 */
 Command * command_new(int type, SimpleCommand * cmd1, SimpleCommand * cmd2){
-	Command * new_cmd = malloc(sizeof(struct command));
-	new_cmd->command_sequence = malloc(sizeof(CommandSequence));
-	new_cmd->command_sequence->command_list = malloc(sizeof(List));
+	// Jeder einfache Befehl der Zeile wird so ein Blatt des Baums: Knoten, Sequenz
+	// und erstes Listenelement in einer einzigen Anforderung an die Arena
+	struct { Command cmd; CommandSequence seq; List lst; } *leaf = arena_alloc(&parse_arena, sizeof(*leaf));
+	Command * new_cmd = &leaf->cmd;
+	new_cmd->left = new_cmd->right = new_cmd->otherwise = NULL;
+	new_cmd->redirect = NULL;
+	new_cmd->command_sequence = &leaf->seq;
+	new_cmd->command_sequence->command_list = &leaf->lst;
 
 	((List *) new_cmd->command_sequence->command_list)->head=cmd1;
 
@@ -58,7 +121,7 @@ Command * command_new(int type, SimpleCommand * cmd1, SimpleCommand * cmd2){
 		new_cmd->command_type=type;
 		new_cmd->command_sequence->command_list_len=2;
 
-		List * lst=malloc(sizeof(List));
+		List * lst=arena_alloc(&parse_arena, sizeof(List));
 		lst->head=cmd2;
 		lst->tail=NULL;
 		new_cmd->command_sequence->command_list->tail=lst;
@@ -74,99 +137,205 @@ Erstellt ein einfaches Kommando mit:
 - Redirectionen (> out.txt)
 - Hintergrundmodus (&)
 */
-SimpleCommand * simple_command_new(int len, char ** tokens, List *redirections, int background){
-	SimpleCommand *cmd=malloc(sizeof(*cmd));
+SimpleCommand * simple_command_new(int len, token_span_t * spans, List *redirections, int background){
+	SimpleCommand *cmd=arena_alloc(&parse_arena, sizeof(*cmd));
 	cmd->redirections=redirections;
 	cmd->command_token_counter=len;
 	cmd->background = background;
-	cmd->command_tokens=tokens;
+	cmd->command_spans=spans;
+	cmd->command_tokens=NULL;
 	return cmd;
 }
 
+/* Prozess-Substitutionen der aktuellen Zeile, wie alles andere in parse_arena */
+static ProcSubstitution **procsubs = NULL;
+static int procsub_count = 0;
+static int procsub_cap = 0;
+
+token_span_t command_procsub(Command *inner, int output){
+	token_span_t span;
+	ProcSubstitution *ps = arena_alloc(&parse_arena, sizeof(*ps));
+
+	if (procsub_count == procsub_cap) {
+		// Wie bei den Tokens: geometrisch wachsen, der alte Block bleibt in der Arena liegen
+		int cap = procsub_cap == 0 ? 4 : 2 * procsub_cap;
+		ProcSubstitution **bigger = arena_alloc(&parse_arena, cap * sizeof(*bigger));
+		if (procsub_count > 0)
+			memcpy(bigger, procsubs, procsub_count * sizeof(*bigger));
+		procsubs = bigger;
+		procsub_cap = cap;
+	}
+	ps->command = inner;
+	ps->output = output;
+	strcpy(ps->path, "/dev/fd/-1");
+	procsubs[procsub_count] = ps;
+
+	span.offset = procsub_count++;
+	span.len = sizeof(ps->path) - 1;   // obere Grenze für argv_fits()
+	span.flags = TOKEN_PROCSUB;
+	return span;
+}
 
-// Gibt den Speicher eines Kommandos (einfach oder zusammengesetzt) vollständig frei.
-void command_delete(Command *cmd) {
-	struct SimpleCommand *cmd_s;
-	List * cmd_lst;
-	switch(cmd->command_type) {
-		case C_EMPTY:
-		free(cmd);
-		break;
-		case C_SIMPLE:
-		cmd_s=(SimpleCommand *) ((List *)cmd->command_sequence->command_list)->head;
-		delete_redirections(cmd_s->redirections);
-		for (int i=0; i< cmd_s->command_token_counter; i++) {
-			free(cmd_s->command_tokens[i]);
+ProcSubstitution * command_procsub_get(token_span_t span){
+	return procsubs[span.offset];
+}
+
+/* Terminiert einen Ausschnitt der Eingabezeile an Ort und Stelle (das Zeichen danach ist schon gelesen) */
+static char * span_string(char *base, token_span_t span){
+	char *str = base + span.offset;
+	str[span.len] = '\0';
+	return str;
+}
+
+/*
+Erzeugt nach dem Parsen einer Zeile die Zeichenketten für execve und die Builtins.
+Die Tokens werden hier nicht kopiert: argv zeigt direkt in die Zeile des Scanners
+(beim SIMD-Lexer die Eingabe selbst, bei flex seine Kopie der Tokens der Zeile),
+die Anführungszeichen hat der Scanner bereits entfernt.
+Eine Prozess-Substitution wird zu ihrem Pfadpuffer, der innere Befehl rekursiv aufbereitet.
+*/
+static void materialize_simple(SimpleCommand *cmd_s, char *base){
+	char **argv = arena_alloc(&parse_arena, (cmd_s->command_token_counter + 1) * sizeof(char *));
+	for (int i = 0; i < cmd_s->command_token_counter; i++) {
+		token_span_t span = cmd_s->command_spans[i];
+		if (span.flags & TOKEN_PROCSUB) {
+			ProcSubstitution *ps = command_procsub_get(span);
+			command_materialize(ps->command, base);
+			argv[i] = ps->path;
+		} else {
+			argv[i] = span_string(base, span);
 		}
-		free(cmd_s->command_tokens);
-		free(cmd_s);
-		free(cmd->command_sequence->command_list);
-		free(cmd->command_sequence);
-		free(cmd);
-		break;
+	}
+	argv[cmd_s->command_token_counter] = NULL;
+	cmd_s->command_tokens = argv;
+
+	for (List *r = cmd_s->redirections; r != NULL; r = r->tail) {
+		Redirection *redirection = r->head;
+		if (redirection->r_type == R_FILE && (redirection->r_span.flags & TOKEN_PROCSUB)) {
+			ProcSubstitution *ps = command_procsub_get(redirection->r_span);
+			command_materialize(ps->command, base);
+			redirection->u.r_file = ps->path;
+		} else if (redirection->r_type == R_FILE) {
+			redirection->u.r_file = span_string(base, redirection->r_span);
+		}
+	}
+}
+
+void command_materialize(Command *cmd, char *base){
+	// Lange Ketten "a ; b ; c ..." hängen links: entlang links laufen statt rekursiv
+	for (;;) {
+		switch (cmd->command_type) {
+		case C_EMPTY:
+			return;
+		case C_SEQUENCE:
 		case C_AND:
 		case C_OR:
-		case C_PIPE:
-		case C_SEQUENCE:
-		cmd_lst=cmd->command_sequence->command_list;
-		do {
-			cmd_s=cmd_lst->head;
-			delete_redirections(cmd_s->redirections);
-			for (int i=0; i< cmd_s->command_token_counter; i++) {
-				free(cmd_s->command_tokens[i]);
-			}
-			free(cmd_s->command_tokens);
-			free(cmd_s);
-
-			void * previous_cmd_lst = cmd_lst;
-			cmd_lst=cmd_lst->tail;
-			free(previous_cmd_lst);
-		} while (cmd_lst!=NULL);
-		free(cmd->command_sequence);
-		free(cmd);
-		break;
+			command_materialize(cmd->right, base);
+			cmd = cmd->left;
+			continue;
+		case C_GROUP:
+		case C_SUBSHELL:
+			if (cmd->redirect != NULL)
+				materialize_simple(cmd->redirect, base);
+			cmd = cmd->left;
+			continue;
+		case C_IF:
+			if (cmd->otherwise != NULL)
+				command_materialize(cmd->otherwise, base);
+			/* fall through */
+		case C_WHILE:
+			command_materialize(cmd->right, base);
+			cmd = cmd->left;
+			continue;
 		default:
-		break;
+			for (List *lst = cmd->command_sequence->command_list; lst != NULL; lst = lst->tail) {
+				materialize_simple(lst->head, base);
+			}
+			return;
+		}
 	}
+}
 
+
+/*
+Gibt den Speicher eines Kommandos frei. Alle Teile (Tokens, Listen, Redirections,
+Prozess-Substitutionen) stammen aus parse_arena, daher genügt ein Reset – unabhängig von der Größe des Kommandos.
+Dazu kommen die memfds der Here-Dokumente.
+*/
+void command_delete(Command *cmd) {
+	(void) cmd;
+	heredoc_release();
+	procsubs = NULL;
+	procsub_count = procsub_cap = 0;
+	arena_reset(&parse_arena);
 }
 
-// Gibt das Kommando in lesbarer Form aus, hilfreich zum Debuggen.
-void command_print(Command *cmd) {
-	struct SimpleCommand *cmd_s;
+// Gibt einen Knoten des Baums mit Einrückung aus, die Operanden eine Stufe tiefer.
+static void node_print(int indent, Command *cmd) {
 	char * type = NULL;
-	List * cmd_lst;
-	printf("--- COMMANDS ---\n");
 	switch(cmd->command_type) {
 		case C_EMPTY:
-		printf("<EMPTY_COMMAND>\n");
+		printf("%*s<EMPTY_COMMAND>\n", indent, "");
 		break;
 		case C_SIMPLE:
-		cmd_s=(SimpleCommand *) ((List *)cmd->command_sequence->command_list)->head;
-		simple_command_print(0,cmd_s);
+		simple_command_print(indent, cmd->command_sequence->command_list->head);
+		break;
+		case C_PIPE:
+		printf( "%*s<PIPE_COMMAND [%i]>\n", indent, "", cmd->command_sequence->command_list_len);
+		for (List *cmd_lst = cmd->command_sequence->command_list; cmd_lst != NULL; cmd_lst = cmd_lst->tail) {
+			simple_command_print(indent + 5, cmd_lst->head);
+		}
+		printf( "%*s</PIPE_COMMAND>\n", indent, "");
 		break;
 		case C_AND:
 		if (type==NULL) type="AND_COMMAND";
 		case C_OR:
 		if (type==NULL) type="OR_COMMAND";
-		case C_PIPE:
-		if (type==NULL) type="PIPE_COMMAND";
 		case C_SEQUENCE:
 		if (type==NULL) type="SEQUENCE_COMMAND";
 
-		printf( "%*s<%s [%i]>\n", 0, "", type, cmd->command_sequence->command_list_len);
-		cmd_lst=cmd->command_sequence->command_list;
-		do {
-			cmd_s=cmd_lst->head;
-			simple_command_print(5, cmd_s);
-			cmd_lst=cmd_lst->tail;
-		} while (cmd_lst!=NULL);
-		printf( "%*s</%s>\n", 0, "", type);
+		printf( "%*s<%s>\n", indent, "", type);
+		node_print(indent + 5, cmd->left);
+		node_print(indent + 5, cmd->right);
+		printf( "%*s</%s>\n", indent, "", type);
+		break;
+		case C_GROUP:
+		case C_SUBSHELL:
+		type = cmd->command_type == C_GROUP ? "GROUP_COMMAND" : "SUBSHELL_COMMAND";
+		printf( "%*s<%s>\n", indent, "", type);
+		node_print(indent + 5, cmd->left);
+		if (cmd->redirect != NULL)
+			simple_command_print(indent + 5, cmd->redirect);
+		printf( "%*s</%s>\n", indent, "", type);
+		break;
+		case C_IF:
+		printf( "%*s<IF_COMMAND>\n", indent, "");
+		node_print(indent + 5, cmd->left);
+		printf( "%*s<THEN>\n", indent, "");
+		node_print(indent + 5, cmd->right);
+		if (cmd->otherwise != NULL) {
+			printf( "%*s<ELSE>\n", indent, "");
+			node_print(indent + 5, cmd->otherwise);
+		}
+		printf( "%*s</IF_COMMAND>\n", indent, "");
+		break;
+		case C_WHILE:
+		printf( "%*s<WHILE_COMMAND>\n", indent, "");
+		node_print(indent + 5, cmd->left);
+		printf( "%*s<DO>\n", indent, "");
+		node_print(indent + 5, cmd->right);
+		printf( "%*s</WHILE_COMMAND>\n", indent, "");
 		break;
 		default:
-		printf( "type [%i] printing not implemented\n", cmd->command_type);
+		printf( "%*stype [%i] printing not implemented\n", indent, "", cmd->command_type);
 		break;
 	}
+}
+
+// Gibt das Kommando in lesbarer Form aus, hilfreich zum Debuggen.
+void command_print(Command *cmd) {
+	printf("--- COMMANDS ---\n");
+	node_print(0, cmd);
 	printf("<<<< COMMANDS >>>>\n");
 }
 
@@ -194,6 +363,9 @@ void print_redirection(int indent, Redirection * r){
 		case M_APPEND:
 		mode= "APPEND";
 		break;
+		case M_HEREDOC:
+		mode= "HEREDOC";
+		break;
 		default:
 		mode="unknown";
 		break;
@@ -210,22 +382,6 @@ void print_redirection(int indent, Redirection * r){
 
 }
 
-// Gibt die gesamte Redirectionsliste eines SimpleCommand frei.
-void delete_redirections(List * rd){
-	if (rd == NULL) return;
-	List *current=rd;
-	List *previous=NULL;
-	while (current != NULL) {
-		previous=current;
-		current=previous->tail;
-		Redirection *r_cur=(Redirection *) previous->head;
-		if (r_cur->r_type==R_FILE)
-		free(r_cur->u.r_file);
-		free(r_cur);
-		free(previous);
-	}
-}
-
 // Gibt ein SimpleCommand in lesbarer Form aus. `indent` wird benutzt, um Einrückungen zu steuern (für verschachtelte Darstellung).
 void simple_command_print(int indent, SimpleCommand *cmd_s){
 	printf("%*s%s", indent, "", "<SIMPLE_COMMAND> {command: \"");
@@ -259,69 +415,111 @@ Beispiel:
 Du hast intern gespeichert: `echo hello > out.txt &`
 → Rückgabe: "echo hello > out.txt & "
 */
-char * command_get(Command *cmd){
-	char *token = "";
-	SimpleCommand *cmd_s;
-	List * cmd_lst;
-	if(cmd->command_type == C_EMPTY) { return NULL; }
-	cmd_lst=cmd->command_sequence->command_list;
-
-	StringBuffer cmd_str = string_buffer_new(8192);
-
-	do {
-		cmd_s=cmd_lst->head;
+/* Hängt ein Token an, eine Prozess-Substitution wieder als <(...) bzw. >(...) */
+static void append_token(StringBuffer *cmd_str, token_span_t span, char *token){
+	if (span.flags & TOKEN_PROCSUB) {
+		ProcSubstitution *ps = command_procsub_get(span);
+		char *inner = command_get(ps->command);
+		string_buffer_append_formatted(cmd_str, "%s(%s) ", ps->output ? ">" : "<", inner != NULL ? inner : "");
+		free(inner);
+	} else if (span.flags & TOKEN_QUOTED) {
+		string_buffer_append_formatted(cmd_str, "\"%s\" ", token);
+	} else {
+		string_buffer_append_formatted(cmd_str, "%s ", token);
+	}
+}
 
-		for (int i = 0; i < cmd_s->command_token_counter; i++) {
-			string_buffer_append_formatted(&cmd_str, "%s ", cmd_s->command_tokens[i]);
-		}
+// Tokens, Umleitungen und & eines einfachen Befehls
+static void simple_command_string(StringBuffer *cmd_str, SimpleCommand *cmd_s){
+	for (int i = 0; i < cmd_s->command_token_counter; i++) {
+		// Anführungszeichen wieder ergänzen, damit der Verlaufseintrag gleich bleibt
+		append_token(cmd_str, cmd_s->command_spans[i], cmd_s->command_tokens[i]);
+	}
 
-		// Verarbeitung der Redirections (<, >, >> ...)
-		List *redirect_lst = cmd_s->redirections;
-		while (redirect_lst != NULL) {
-			Redirection *redirection = (Redirection *)redirect_lst->head;
-
-			if (redirection->r_type == R_FILE) {
-				char *r_token = "";
-				switch (redirection->r_mode) {
-					case M_READ: r_token = "<"; break;
-					case M_WRITE: r_token = ">"; break;
-					case M_APPEND: r_token = ">>"; break;
-					default: break;
-				}
-				string_buffer_append_formatted(&cmd_str, "%s %s ", r_token, redirection->u.r_file);
+	// Verarbeitung der Redirections (<, >, >> ...)
+	List *redirect_lst = cmd_s->redirections;
+	while (redirect_lst != NULL) {
+		Redirection *redirection = (Redirection *)redirect_lst->head;
+
+		if (redirection->r_type == R_FILE) {
+			char *r_token = "";
+			switch (redirection->r_mode) {
+				case M_READ: r_token = "<"; break;
+				case M_WRITE: r_token = ">"; break;
+				case M_APPEND: r_token = ">>"; break;
+				default: break;
 			}
-			redirect_lst = redirect_lst->tail;
+			string_buffer_append_formatted(cmd_str, "%s ", r_token);
+			append_token(cmd_str, redirection->r_span, redirection->u.r_file);
 		}
+		redirect_lst = redirect_lst->tail;
+	}
 
-		if (cmd_s->background && cmd_lst->tail == NULL) {
-			string_buffer_append_formatted(&cmd_str, "& ");
-		}
+	if (cmd_s->background) {
+		string_buffer_append_formatted(cmd_str, "& ");
+	}
+}
 
-		cmd_lst=cmd_lst->tail;
-		if (cmd_lst != NULL){
-			switch(cmd->command_type) {
-				case C_IF:
-				case C_WHILE:
-				case C_EMPTY:
-				break;
-				case C_SIMPLE:
-				token=" ";
-				break;
-				case C_AND:
-				token="&&";
-				break;
-				case C_OR:
-				token="||";
-				break;
-				case C_PIPE:
-				token="|";
-				break;
-				case C_SEQUENCE:
-				token=";";
-				break;
-			}
-			string_buffer_append_formatted(&cmd_str, "%s ", token);
+// Hängt einen Knoten an, Operatoren zwischen den Operanden, Gruppen in Klammern
+static void command_string(StringBuffer *cmd_str, Command *cmd){
+	char *token;
+	switch(cmd->command_type) {
+		case C_SIMPLE:
+		case C_PIPE:
+		for (List *cmd_lst = cmd->command_sequence->command_list; cmd_lst != NULL; cmd_lst = cmd_lst->tail) {
+			simple_command_string(cmd_str, cmd_lst->head);
+			if (cmd_lst->tail != NULL)
+				string_buffer_append_formatted(cmd_str, "| ");
 		}
-	} while (cmd_lst!=NULL);
+		break;
+		case C_AND:
+		case C_OR:
+		case C_SEQUENCE:
+		token = cmd->command_type == C_AND ? "&&" : cmd->command_type == C_OR ? "||" : ";";
+		command_string(cmd_str, cmd->left);
+		string_buffer_append_formatted(cmd_str, "%s ", token);
+		command_string(cmd_str, cmd->right);
+		break;
+		case C_GROUP:
+		command_string(cmd_str, cmd->left);
+		if (cmd->redirect != NULL)
+			simple_command_string(cmd_str, cmd->redirect);
+		break;
+		case C_SUBSHELL:
+		string_buffer_append_formatted(cmd_str, "( ");
+		command_string(cmd_str, cmd->left);
+		string_buffer_append_formatted(cmd_str, ") ");
+		if (cmd->redirect != NULL)
+			simple_command_string(cmd_str, cmd->redirect);
+		break;
+		case C_IF:
+		// einzeilig, auch wenn die Eingabe mehrere Zeilen hatte; elif wird zu else if ... fi
+		string_buffer_append_formatted(cmd_str, "if ");
+		command_string(cmd_str, cmd->left);
+		string_buffer_append_formatted(cmd_str, "; then ");
+		command_string(cmd_str, cmd->right);
+		if (cmd->otherwise != NULL) {
+			string_buffer_append_formatted(cmd_str, "; else ");
+			command_string(cmd_str, cmd->otherwise);
+		}
+		string_buffer_append_formatted(cmd_str, "; fi ");
+		break;
+		case C_WHILE:
+		string_buffer_append_formatted(cmd_str, "while ");
+		command_string(cmd_str, cmd->left);
+		string_buffer_append_formatted(cmd_str, "; do ");
+		command_string(cmd_str, cmd->right);
+		string_buffer_append_formatted(cmd_str, "; done ");
+		break;
+		default:
+		break;
+	}
+}
+
+char * command_get(Command *cmd){
+	if(cmd->command_type == C_EMPTY) { return NULL; }
+
+	StringBuffer cmd_str = string_buffer_new(8192);
+	command_string(&cmd_str, cmd);
 	return cmd_str.cstring;
-}
\ No newline at end of file
+}
@@ -9,6 +9,7 @@
 #define COMMAND_H
 
 #include "list.h"
+#include "types.h"
 
 /*
  * Es gibt verschiedene Arten von Befehlen
@@ -21,7 +22,9 @@ typedef enum {
     C_AND,           /* mit "&&" */
     C_OR,            /* mit "||" */
     C_IF,            /* bedingte Ausführung */
-    C_WHILE          /* Schleifenkonstruktion */
+    C_WHILE,         /* Schleifenkonstruktion */
+    C_GROUP,         /* Umleitungen für einen ganzen Befehl (if/while ... > datei), läuft in der Shell */
+    C_SUBSHELL       /* ( ... ) mit Umleitungen, läuft in einem Kind */
 } CommandType;
 
 /*
@@ -31,7 +34,8 @@ typedef enum {
 typedef enum {
     M_READ,            /* <  = lesen */
     M_WRITE,           /* >  = schreiben (überschreibt) */
-    M_APPEND           /* >> = anhängen */
+    M_APPEND,          /* >> = anhängen */
+    M_HEREDOC          /* << und <<< = Text aus einem memfd lesen (u.r_fd, siehe heredoc.h) */
 } RedirectionMode;
 
 /*
@@ -53,6 +57,7 @@ typedef struct {
         int r_fd;         /* Dateideskriptor (Quelle oder Ziel) */
         char * r_file;    /* vollständiger Dateiname (Quelle oder Ziel) */
     } u;
+    token_span_t r_span;  /* Dateiname als Ausschnitt der Eingabezeile, r_file erst nach command_materialize() */
 } Redirection;
 
 /*
@@ -63,7 +68,8 @@ typedef struct SimpleCommand {
   List *redirections;   // Liste von Redirection-Objekten
   int  command_token_counter;   // Anzahl der Tokens
   int background;    // 1 = im Hintergrund (&), 0 = im Vordergrund
-  char ** command_tokens;  // Array von Zeichenketten (z. B. {"ls", "-l", NULL})
+  char ** command_tokens;  // Array von Zeichenketten (z. B. {"ls", "-l", NULL}), erst nach command_materialize()
+  token_span_t * command_spans;  // Tokens als Ausschnitte der Eingabezeile (vom Parser)
 } SimpleCommand;
 
 
@@ -75,13 +81,43 @@ typedef struct {
   int  command_list_len;
 } CommandSequence;
 
+/*
+ * Ein Befehl ist ein Operatorbaum: ";", "&&" und "||" sind binäre Knoten
+ * (linksassoziativ, ";" bindet am schwächsten), die Blätter sind einfache
+ * Befehle und Pipes, deren Stufen flach in command_sequence stehen.
+ * "a && b || c ; d | e" wird zu SEQUENCE(OR(AND(a, b), c), PIPE(d, e)).
+ * "if a; then b; elif c; then d; fi" wird zu IF(a, b, IF(c, d, NULL)).
+ */
 typedef struct command {
     CommandType command_type;
-    CommandSequence *command_sequence;
+    CommandSequence *command_sequence;  /* C_SIMPLE, C_PIPE: die einfachen Befehle */
+    struct command *left;    /* C_SEQUENCE, C_AND, C_OR: linker Operand, C_GROUP, C_SUBSHELL: Inhalt, C_IF, C_WHILE: Bedingung */
+    struct command *right;   /* C_SEQUENCE, C_AND, C_OR: rechter Operand, C_IF: then-Teil, C_WHILE: Schleifenrumpf */
+    struct command *otherwise; /* C_IF: else-Teil (elif: ein weiteres C_IF), sonst NULL */
+    SimpleCommand *redirect; /* C_GROUP, C_SUBSHELL: Umleitungen der Gruppe (Befehl ohne Tokens), sonst NULL */
 } Command;
 
+/*
+ * Eine Prozess-Substitution <(befehl) oder >(befehl). Im Token steht TOKEN_PROCSUB,
+ * sein offset ist der Index in der Tabelle der aktuellen Zeile.
+ */
+typedef struct {
+    Command *command;   /* innerer Befehl */
+    int output;         /* 0 = <(...) liest dessen Ausgabe, 1 = >(...) schreibt in seine Eingabe */
+    char path[24];      /* "/dev/fd/N", erst beim Start gesetzt (siehe execute.c) */
+} ProcSubstitution;
+
 /* Funktion zum Erstellen eines neuen einfachen Befehls */
-SimpleCommand * simple_command_new(int, char **, List *, int);
+SimpleCommand * simple_command_new(int, token_span_t *, List *, int);
+
+/* Baut argv und Dateinamen aus den Token-Ausschnitten, <base> ist yy_token_base() */
+void command_materialize(Command *cmd, char *base);
+
+/* Legt eine Prozess-Substitution für <inner> an und liefert ihr Token (für den Parser) */
+token_span_t command_procsub(Command *inner, int output);
+
+/* Die Prozess-Substitution zu einem Token mit TOKEN_PROCSUB */
+ProcSubstitution * command_procsub_get(token_span_t span);
 
 /* Erstellt einen leeren Befehl */
 Command * command_new_empty();
@@ -92,15 +128,30 @@ Command * command_new(int type, SimpleCommand * cmd, SimpleCommand * cmd2);
 /* Fügt einen einfachen Befehl an einen bestehenden komplexen Befehl an */
 Command * command_append(int type, SimpleCommand * s_cmd, Command * cmd);
 
+/* Verknüpft zwei Befehle mit ";", "&&" oder "||" (C_SEQUENCE, C_AND, C_OR) */
+Command * command_binary(int type, Command *left, Command *right);
+
+/* Klammert <body>, <redirections> gelten für die ganze Gruppe */
+Command * command_group(Command *body, List *redirections);
+
+/* ( <body> ) <redirections>: wie command_group(), läuft aber in einem Kind */
+Command * command_subshell(Command *body, List *redirections);
+
+/* if <cond>; then <then_part>; else <else_part>; fi, <else_part> darf NULL sein */
+Command * command_if(Command *cond, Command *then_part, Command *else_part);
+
+/* while <cond>; do <body>; done */
+Command * command_while(Command *cond, Command *body);
+
+/* Erster einfacher Befehl (ganz links im Baum), NULL für C_EMPTY, C_IF und C_WHILE */
+SimpleCommand * command_first(Command *cmd);
+
 /* Gibt den Befehl formatiert auf der Konsole aus */
 void command_print(Command *cmd);
 
-/* Gibt den belegten Speicher des Befehls frei */
+/* Gibt den belegten Speicher des Befehls frei (Reset der parse_arena und der Prozess-Substitutionen) */
 void command_delete(Command *cmd);
 
-/* Gibt den Speicher für alle Umleitungen frei */
-void delete_redirections(List *rd);
-
 /* Gibt einen einfachen Befehl mit Einrückung aus (für Debug-Zwecke) */
 void simple_command_print(int indent, SimpleCommand *cmd_s);
 
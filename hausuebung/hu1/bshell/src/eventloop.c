@@ -0,0 +1,211 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+#include <sys/epoll.h>
+#include "eventloop.h"
+#include "statuslist.h"
+#include "jobserver.h"
+#include "shell.h"
+#include "debug.h"
+
+static int signal_fd = -1;
+static int epoll_fd = -1;
+
+/*
+ * Prozesse, die zum Vordergrund gehören (eventloop_watch). Mehrere Gruppen
+ * können verschachtelt sein, z. B. eine Pipe, deren letzte Stufe "xargs" in
+ * der Shell ist und selbst auf ihre Aufrufe wartet.
+ */
+#define WATCH_DEPTH 8
+
+typedef struct {
+    const pid_t *pids;
+    int *statuses;
+    int count;
+    int remaining;
+} WatchSet;
+
+static WatchSet watched[WATCH_DEPTH];
+static int watch_depth = 0;
+static int no_children = 0;
+static UsageSum *account = NULL;
+
+/* beendete Hintergrundjobs, die noch gemeldet werden müssen */
+static pid_t *done_jobs = NULL;
+static int done_count = 0;
+static int done_cap = 0;
+
+void eventloop_init() {
+    sigset_t set;
+    struct epoll_event ev;
+
+    // Ab jetzt kommt SIGCHLD nur noch über signalfd an, nie asynchron.
+    // Gestartete Programme bekommen eine leere Signalmaske (siehe launcher.c).
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+
+    signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (signal_fd < 0 || epoll_fd < 0) {
+        perror("eventloop");
+        exit(1);
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = signal_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev) < 0) {
+        perror("eventloop");
+        exit(1);
+    }
+}
+
+void eventloop_forked() {
+    close(signal_fd);
+    close(epoll_fd);
+    watch_depth = 0;
+    no_children = 0;
+    account = NULL;
+    done_count = 0;
+    eventloop_init();
+}
+
+int eventloop_fd() {
+    return epoll_fd;
+}
+
+static void remember_done_job(pid_t pid) {
+    if (done_count == done_cap) {
+        done_cap = done_cap == 0 ? 16 : done_cap * 2;
+        done_jobs = realloc(done_jobs, done_cap * sizeof(pid_t));
+        if (done_jobs == NULL) {
+            perror("eventloop");
+            exit(1);
+        }
+    }
+    done_jobs[done_count++] = pid;
+}
+
+int eventloop_reap() {
+    struct signalfd_siginfo info[16];
+    struct rusage usage;
+    int status;
+    pid_t pid;
+
+    // Die Signale selbst werden nur verworfen: mehrere SIGCHLD können zu einem
+    // zusammenfallen, daher sammelt wait4 danach alles ein, was beendet ist.
+    // Ein Kind, das erst danach endet, macht signalfd wieder lesbar.
+    while (read(signal_fd, info, sizeof(info)) > 0)
+        ;
+
+    // wait4 liefert den Ressourcenverbrauch gleich mit, ohne weiteren Syscall
+    while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        int foreground = 0;
+
+        statuslist_update(pid, status, &usage);
+        jobserver_release(pid);
+        for (int w = watch_depth - 1; w >= 0 && !foreground; w--) {
+            WatchSet *set = &watched[w];
+            for (int i = 0; i < set->count; i++) {
+                if (set->pids[i] == pid) {
+                    set->statuses[i] = status;
+                    set->remaining--;
+                    foreground = 1;
+                    if (account != NULL) {
+                        usage_add(account, &usage);
+                    }
+                    break;
+                }
+            }
+        }
+        // Nur interaktiv gibt es jemanden, dem Hintergrundjobs gemeldet werden
+        if (!foreground && shell_interactive) {
+            remember_done_job(pid);
+        }
+    }
+    no_children = (pid < 0 && errno == ECHILD);
+    return done_count;
+}
+
+void eventloop_watch(const pid_t *pids, int count, int *statuses) {
+    if (watch_depth == WATCH_DEPTH) {
+        fprintf(stderr, "eventloop: too many nested waits\n");
+        exit(1);
+    }
+    watched[watch_depth].pids = pids;
+    watched[watch_depth].statuses = statuses;
+    watched[watch_depth].count = count;
+    watched[watch_depth].remaining = count;
+    watch_depth++;
+}
+
+void eventloop_wait_watched(int until_remaining) {
+    WatchSet *set = &watched[watch_depth - 1];
+    struct epoll_event ev;
+
+    eventloop_reap();
+    while (set->remaining > until_remaining && !no_children) {
+        if (epoll_wait(epoll_fd, &ev, 1, -1) < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        eventloop_reap();
+    }
+}
+
+void eventloop_unwatch() {
+    watch_depth--;
+}
+
+void eventloop_wait(const pid_t *pids, int count, int *statuses) {
+    for (int i = 0; i < count; i++) {
+        statuses[i] = 0;
+    }
+    eventloop_watch(pids, count, statuses);
+    eventloop_wait_watched(0);
+    eventloop_unwatch();
+}
+
+void eventloop_wait_any(const pid_t *pids, int count, int *statuses) {
+    if (count > 0) {
+        eventloop_watch(pids, count, statuses);
+        eventloop_wait_watched(count - 1);
+        eventloop_unwatch();
+    }
+}
+
+void eventloop_account(UsageSum *sum) {
+    account = sum;
+}
+
+void usage_add(UsageSum *sum, const struct rusage *usage) {
+    timeradd(&sum->utime, &usage->ru_utime, &sum->utime);
+    timeradd(&sum->stime, &usage->ru_stime, &sum->stime);
+    if (usage->ru_maxrss > sum->maxrss)
+        sum->maxrss = usage->ru_maxrss;
+    sum->minflt += usage->ru_minflt;
+    sum->majflt += usage->ru_majflt;
+    sum->nvcsw += usage->ru_nvcsw;
+    sum->nivcsw += usage->ru_nivcsw;
+    sum->processes++;
+}
+
+int eventloop_notify() {
+    int count = done_count;
+
+    for (int i = 0; i < done_count; i++) {
+        const ProcessInfo *info = statuslist_find(done_jobs[i]);
+        char status_str[32];
+
+        statuslist_status_string(info, status_str, sizeof(status_str));
+        printf("[%d] %-12s %s\n", done_jobs[i], status_str, info != NULL ? info->command : "");
+    }
+    done_count = 0;
+    fflush(stdout);
+    return count;
+}
@@ -0,0 +1,84 @@
+/*
+ * eventloop.h
+ *
+ * Einziger Ort, an dem die Shell Kinder einsammelt. SIGCHLD ist in der Shell
+ * dauerhaft blockiert und wird über signalfd gelesen; ein epoll-Deskriptor
+ * wartet darauf. Vordergrund-Wartezeiten, Hintergrundjobs und die Meldungen
+ * an der Eingabezeile laufen alle über eventloop_reap().
+ *
+ */
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+/* Summe der Ressourcen mehrerer Prozesse (für den time-Präfix) */
+typedef struct {
+    struct timeval utime;
+    struct timeval stime;
+    long maxrss;        /* Maximum, nicht Summe (KiB) */
+    long minflt;
+    long majflt;
+    long nvcsw;
+    long nivcsw;
+    int processes;
+} UsageSum;
+
+/* SIGCHLD blockieren, signalfd und epoll anlegen (einmal beim Start) */
+void eventloop_init();
+
+/*
+ * Im Kind nach fork (Subshell): geerbtes signalfd/epoll schließen und eigene
+ * anlegen (epoll teilt sich sonst die Eltern-Shell), Vordergrund und Meldungen leeren
+ */
+void eventloop_forked();
+
+/* epoll-Deskriptor, wird lesbar, sobald ein Kind beendet wurde */
+int eventloop_fd();
+
+/*
+ * Sammelt alle beendeten Kinder ein (ohne zu blockieren) und trägt sie in die
+ * Statusliste ein. Beendete Hintergrundjobs werden für eventloop_notify() vorgemerkt.
+ * Rückgabe: Anzahl der vorgemerkten, noch nicht gemeldeten Jobs.
+ */
+int eventloop_reap();
+
+/*
+ * Wartet, bis alle <count> Prozesse beendet sind. <statuses> bekommt den
+ * waitpid-Status jedes Prozesses (gleiche Reihenfolge wie <pids>).
+ */
+void eventloop_wait(const pid_t *pids, int count, int *statuses);
+
+/*
+ * Wie eventloop_wait(), kehrt aber zurück, sobald mindestens einer beendet ist.
+ * <statuses> muss vorher mit -1 belegt sein; jeder beendete Prozess bekommt
+ * seinen waitpid-Status (es können auch mehrere auf einmal sein).
+ */
+void eventloop_wait_any(const pid_t *pids, int count, int *statuses);
+
+/*
+ * Meldet <count> Prozesse als Vordergrund an: ihr waitpid-Status landet in
+ * <statuses>, auch wenn sie eingesammelt werden, während noch etwas anderes
+ * läuft (z. B. ein Builtin am Ende der Pipe). Sie werden nie als Hintergrundjob
+ * gemeldet. eventloop_wait_watched() wartet auf die zuletzt angemeldete Gruppe,
+ * bis höchstens noch <until_remaining> laufen; eventloop_unwatch() meldet sie ab.
+ */
+void eventloop_watch(const pid_t *pids, int count, int *statuses);
+void eventloop_wait_watched(int until_remaining);
+void eventloop_unwatch();
+
+/*
+ * Solange <sum> gesetzt ist, wird der Verbrauch jedes Prozesses, auf den
+ * eventloop_wait() wartet, dazu addiert. NULL beendet das Mitzählen.
+ */
+void eventloop_account(UsageSum *sum);
+
+/* Addiert <usage> zu <sum> */
+void usage_add(UsageSum *sum, const struct rusage *usage);
+
+/* Gibt die vorgemerkten Meldungen über beendete Hintergrundjobs aus, liefert deren Anzahl */
+int eventloop_notify();
+
+#endif /* EVENTLOOP_H */
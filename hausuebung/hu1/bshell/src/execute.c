@@ -12,408 +12,1154 @@
 #include <pwd.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include "statuslist.h"
 #include "debug.h"
 #include "execute.h"
-
-/* do not modify this */
-#ifndef NOLIBREADLINE
-#include <readline/history.h>
-#endif /* NOLIBREADLINE */
+#include "launcher.h"
+#include "builtins.h"
+#include "eventloop.h"
+#include "jobserver.h"
+#include "profile.h"
+#include "program.h"
+#include "pathcache.h"
 
 extern int shell_pid; // PID der Hauptshell
 extern int fdtty; // Dateideskriptor des Terminals, verwendet zur Verwaltung von Prozessgruppen (tcsetpgrp)
 
-/* do not modify this */
-#ifndef NOLIBREADLINE
-static int builtin_hist(char ** command){ // Zeigt die bisherigen Befehle an, wenn "hist" eingegeben wird.
-    register HIST_ENTRY **the_list;
-    register int i;
-    printf("--- History --- \n");
+/*
+ * Präfixe vor dem ersten Befehl einer Zeile (z. B. "time"), die für die ganze
+ * Zeile gelten, also auch für eine Pipe oder eine &&-Kette.
+ */
+typedef struct {
+    int time;        // Laufzeit und Ressourcen der ganzen Zeile ausgeben
+    long pipe_size;  // Puffergröße der Pipes dieser Zeile, 0 = globale Einstellung
+    int profile;     // Relays zwischen den Stufen der Pipe, Bericht am Ende
+    double profile_interval; // profile -i: laufende Ausgabe alle n Sekunden, 0 = keine
+    const RunOptions *run;   // Scheduling der gestarteten Programme, NULL = wie die Shell
+} ExecOptions;
+
+static ExecOptions exec_options; // Präfixe der gerade ausgeführten Zeile
+
+/*
+ * Ein Präfix wertet seine Wörter ab argv[0] aus und liefert, wie viele es verbraucht,
+ * 0 wenn es doch kein Präfix ist (dann läuft das gleichnamige Builtin), oder -1 bei
+ * einem Fehler (Meldung ausgegeben).
+ */
+typedef int (*PrefixFunc)(char **argv, ExecOptions *opts);
+
+static int prefix_time(char **argv, ExecOptions *opts) {
+    opts->time = 1;
+    return 1;
+}
+
+/* "pipesize 1M a | b": nur mit folgendem Befehl ein Präfix, sonst das Builtin (global) */
+static int prefix_pipesize(char **argv, ExecOptions *opts) {
+    long size;
 
-    the_list = history_list ();
-    if (the_list)
-        for (i = 0; the_list[i]; i++)
-            printf ("%d: %s\n", i + history_base, the_list[i]->line);
-    else {
-        printf("history could not be found!\n");
+    if (argv[1] == NULL || argv[2] == NULL) {
+        return 0;
+    }
+    size = pipe_size_parse(argv[1]);
+    if (size < 0) {
+        fprintf(stderr, "-bshell: pipesize: %s: invalid size\n", argv[1]);
+        return -1;
     }
+    opts->pipe_size = pipe_size_clamp(size);
+    return 2;
+}
 
-    printf("--------------- \n");
-    return 0;
+/* "profile [-i SEK] a | b | c" */
+static int prefix_profile(char **argv, ExecOptions *opts) {
+    char *end;
+
+    opts->profile = 1;
+    if (argv[1] == NULL || strcmp(argv[1], "-i") != 0) {
+        return 1;
+    }
+    opts->profile_interval = argv[2] != NULL ? strtod(argv[2], &end) : 0;
+    if (argv[2] == NULL || *end != '\0' || opts->profile_interval <= 0) {
+        fprintf(stderr, "-bshell: profile: -i: invalid interval\n");
+        return -1;
+    }
+    return 3;
 }
-#endif /*NOLIBREADLINE*/
-
-/* Entfernt Anführungszeichen um ein Wort, z. B. "hello" wird zu hello */
-void unquote(char * s){
-	if (s!=NULL){
-		if (s[0] == '"' && s[strlen(s)-1] == '"'){
-	        char * buffer = calloc(sizeof(char), strlen(s) + 1);
-			strcpy(buffer, s);
-			strncpy(s, buffer+1, strlen(buffer)-2);
-            s[strlen(s)-2]='\0';
-			free(buffer);
-		}
-	}
-}
-
-/* Wendet unquote auf jedes Wort des Befehls an */
-void unquote_command_tokens(char ** tokens){
-    int i=0;
-    while(tokens[i] != NULL) {
-        unquote(tokens[i]);
-        i++;
-    }
-}
-
-/* Entfernt Anführungszeichen in Dateinamen von Umleitungen ("out.txt" → out.txt) */
-void unquote_redirect_filenames(List *redirections){
-    List *lst = redirections;
-    while (lst != NULL) {
-        Redirection *redirection = (Redirection *)lst->head;
-        if (redirection->r_type == R_FILE) {
-            unquote(redirection->u.r_file);
-        }
-        lst = lst->tail;
-    }
-}
-
-/* Führt das Unquoting auf den gesamten Befehl aus, unabhängig von seiner Form (einfach oder Liste) */
-void unquote_command(Command *cmd){
-    List *lst = NULL;
-    switch (cmd->command_type) {
-        case C_SIMPLE:
-        case C_OR:
-        case C_AND:
-        case C_PIPE:
-        case C_SEQUENCE:
-            lst = cmd->command_sequence->command_list;
-            while (lst != NULL) {
-                SimpleCommand *cmd_s = (SimpleCommand *)lst->head;
-                unquote_command_tokens(cmd_s->command_tokens);
-                unquote_redirect_filenames(cmd_s->redirections);
-                lst = lst->tail;
+
+/* "run --cpus=0-3 --policy=batch --nice=10 --ioprio=idle cmd": gilt für jede gestartete Stufe */
+static int prefix_run(char **argv, ExecOptions *opts) {
+    static RunOptions run;
+
+    // mehrere run-Präfixe in einer Zeile ergänzen sich
+    if (opts->run == NULL) {
+        memset(&run, 0, sizeof(run));
+        run.policy = -1;
+        run.ioprio = -1;
+        opts->run = &run;
+    }
+    return run_options_parse(argv, &run);
+}
+
+static const struct {
+    const char *name;
+    PrefixFunc func;
+} prefixes[] = {
+    { "pipesize", prefix_pipesize },
+    { "profile", prefix_profile },
+    { "run", prefix_run },
+    { "time", prefix_time },
+};
+
+/* Entfernt die Präfixe vom ersten Befehl und trägt sie in <opts> ein. Rückgabe: 0 oder -1 */
+static int strip_prefixes(Command *cmd, ExecOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    SimpleCommand *first = command_first(cmd);
+    if (first == NULL) {
+        return 0;
+    }
+
+    for (;;) {
+        PrefixFunc func = NULL;
+        for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+            if (strcmp(first->command_tokens[0], prefixes[i].name) == 0) {
+                func = prefixes[i].func;
+                break;
             }
-            break;
-        case C_EMPTY:
-        default:
-            break;
+        }
+        if (func == NULL) {
+            return 0;
+        }
+
+        int used = func(first->command_tokens, opts);
+        if (used <= 0) {
+            return used;
+        }
+        if (used >= first->command_token_counter) {
+            fprintf(stderr, "-bshell: %s: command expected\n", first->command_tokens[0]);
+            return -1;
+        }
+        // argv, Ausschnitte und Anzahl liegen in der parse_arena, einfach weiterschieben
+        first->command_tokens += used;
+        first->command_spans += used;
+        first->command_token_counter -= used;
+    }
+}
+
+static double timeval_s(const struct timeval *tv) {
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+/* Ausgabe von "time" auf stderr, Zeiten im Format der bash */
+static void report_time(const struct timespec *start, const struct timespec *end, const UsageSum *sum) {
+    double real = (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+    double user = timeval_s(&sum->utime);
+    double sys = timeval_s(&sum->stime);
+
+    fprintf(stderr, "\nreal\t%dm%.3fs\n", (int)(real / 60), real - 60 * (int)(real / 60));
+    fprintf(stderr, "user\t%dm%.3fs\n", (int)(user / 60), user - 60 * (int)(user / 60));
+    fprintf(stderr, "sys\t%dm%.3fs\n", (int)(sys / 60), sys - 60 * (int)(sys / 60));
+    fprintf(stderr, "rss\t%ld KiB max, %d processes\n", sum->maxrss, sum->processes);
+    fprintf(stderr, "faults\t%ld minor, %ld major\n", sum->minflt, sum->majflt);
+    fprintf(stderr, "csw\t%ld voluntary, %ld involuntary\n", sum->nvcsw, sum->nivcsw);
+}
+
+long pipe_size = 0;
+
+int execute_print_program = 0;
+
+long pipe_size_parse(const char *text) {
+    char *end;
+    long size = strtol(text, &end, 10);
+
+    if (end == text || size < 0) {
+        return -1;
     }
+    if (*end == 'k' || *end == 'K') {
+        size *= 1024;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        size *= 1024 * 1024;
+        end++;
+    }
+    return *end == '\0' && size <= (1L << 30) ? size : -1;
+}
+
+long pipe_size_clamp(long size) {
+    static long max_size = 0;
+
+    if (max_size == 0) {
+        FILE *f = fopen("/proc/sys/fs/pipe-max-size", "r");
+        if (f == NULL || fscanf(f, "%ld", &max_size) != 1 || max_size <= 0)
+            max_size = 1024 * 1024;   // Vorgabe von Linux
+        if (f != NULL)
+            fclose(f);
+    }
+    return size > max_size ? max_size : size;
 }
 
-/* Holt sich die Tokens des Befehls (z. B. ls, -l) und startet fork(): */
-static int execute_fork(SimpleCommand *cmd_s, int background) {
+/* Übergibt das Terminal an eine Prozessgruppe – nur mit Jobkontrolle (interaktiv) */
+static void give_terminal(pid_t pgid) {
+    if (shell_interactive)
+        tcsetpgrp(fdtty, pgid);
+}
+
+/* Exit-Status wie in der bash: Exit-Code oder 128 + Signalnummer */
+static int exit_status(int status) {
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+/*
+ * Prozess-Substitutionen eines Befehls: <(a) und >(b) laufen als eigene Pipes, bevor
+ * der Befehl startet. Die Shell hält ihr Ende der Pipe (O_CLOEXEC), der Befehl erbt es
+ * über keep_fds und findet es unter /dev/fd/N. Gewartet wird nach dem Befehl.
+ */
+typedef struct {
+    int count;
+    int *fds;                // Enden der Shell, nach Befehl geordnet (keep_fds)
+    SimpleCommand **owners;  // Befehl, dem fds[i] übergeben wird
+    pid_t *pids;             // alle gestarteten Prozesse, als eine Gruppe überwacht
+    int *statuses;
+    int pid_count;
+} ProcSubs;
+
+// Implementierung nach den Pipes, die sie zum Starten verwenden
+static int procsubs_start(ProcSubs *ps, SimpleCommand **cmds, int n);
+static void procsubs_finish(ProcSubs *ps, int wait);
+
+/*
+ * Startet den Befehl über die Spawn-Schicht (posix_spawn statt fork) und wartet im Vordergrund.
+ * <path> ist der schon aufgelöste Pfad des Programms.
+ * Rückgabe: Exit-Status des Kindes, 0 für Hintergrundprozesse, der negative Status
+ * (wie spawn_simple_command()) wenn der Start fehlschlug
+ */
+static int execute_fork(SimpleCommand *cmd_s, const char *path, int background, const int *keep_fds, int keep_count) {
     char **command = cmd_s->command_tokens;
+    SpawnOptions opts = { .fd_in = -1, .fd_out = -1, .pgid = 0, .path = path, .run = exec_options.run,
+                          .keep_fds = keep_fds, .keep_count = keep_count };
+    int res = 0;
     pid_t pid;
 
-    pid = fork();
+    // Hintergrundjobs brauchen einen freien Platz (jobs -j N), sonst wird hier gewartet
+    if (background) {
+        jobserver_acquire();
+    }
 
-    if (pid == 0) {
-        // ==== KINDPROZESS ====
-        signal(SIGINT, SIG_DFL);
-        signal(SIGTTOU, SIG_DFL);
-
-        // === UMLEITUNGEN ===
-        List *redirige = cmd_s->redirections;
-        while (redirige != NULL) {
-            Redirection *redir = (Redirection *)redirige->head;
-            int fd;
-
-            if (redir->r_type == R_FILE) {
-                if (redir->r_mode == M_WRITE)
-                    fd = open(redir->u.r_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                else if (redir->r_mode == M_APPEND)
-                    fd = open(redir->u.r_file, O_WRONLY | O_CREAT | O_APPEND, 0644);
-                else // M_READ
-                    fd = open(redir->u.r_file, O_RDONLY);
-
-                if (fd < 0) {
-                    fprintf(stderr, "%s: %s: %s\n", command[0], redir->u.r_file, strerror(errno));
-                    exit(1);
-                }
+    // SIGCHLD ist dauerhaft blockiert (eventloop.c), das Kind kann also nicht
+    // vor statuslist_add() eingesammelt werden
+    pid = spawn_simple_command(cmd_s, &opts);
+    if (pid < 0) {
+        if (background) {
+            jobserver_cancel();
+        }
+        return pid;
+    }
+    if (background) {
+        jobserver_attach(pid);
+    }
 
-                if (redir->r_mode == M_READ)
-                    dup2(fd, STDIN_FILENO);
-                else
-                    dup2(fd, STDOUT_FILENO);
+    // ==== ELTERNPROZESS ====
+    // setpgid() erledigt bereits das Spawn-Attribut vor dem exec
+    if (shell_interactive)
+        printf(">> [basicsh] executing: %s\n", command[0]);
+    statuslist_add(pid, shell_interactive ? pid : getpgrp(), command[0]);
 
-                close(fd);
-            }
+    if (!background) {
+        give_terminal(pid);  // Terminal an Kindprozess übergeben
 
-            redirige = redirige->tail;
-        }
+        int status;
+        eventloop_wait(&pid, 1, &status);
+        give_terminal(shell_pid); // Terminal zurückholen
 
-        execvp(command[0], command);
-        fprintf(stderr, "-bshell: %s : command not found\n", command[0]);
-        exit(EXIT_FAILURE);
+        res = exit_status(status);
+    }
 
-    } else if (pid < 0) {
-        // ==== FEHLER BEIM FORK ====
-        perror("shell");
-        return 1;
+    return res;
+}
 
-    } else {
-        // ==== ELTERNPROZESS ====
-        printf(">> [basicsh] executing: %s\n", command[0]);
-        statuslist_add(pid, pid, command[0]);
-        setpgid(pid, pid);  // In eigene Prozessgruppe setzen
+/*
+ * Pfad des Programms einer OP_SIMPLE-Instruktion: beim ersten Start über den pathcache
+ * gesucht (mit der Prüfung gegen ARG_MAX) und in der Instruktion gemerkt, eine Schleife
+ * sucht also nur einmal. Leert "hash -r", ein neues $PATH oder ein geändertes Verzeichnis
+ * die Tabelle, wird neu gesucht. Das Programm lebt nur eine Zeile, der gemerkte Pfad
+ * also nie länger als bis pathcache_release(). NULL: nicht startbar (Meldung ausgegeben),
+ * <status> ist dann 127 (nicht gefunden) bzw. 126.
+ */
+static const char * instruction_path(Instruction *ins, int *status) {
+    SpawnOptions opts = { .path = NULL };
+    int err;
 
-        if (!background) {
-            tcsetpgrp(fdtty, pid);  // Terminal an Kindprozess übergeben
+    if (ins->path != NULL && ins->generation == pathcache_generation())
+        return ins->path;
+    if ((err = spawn_prepare(ins->u.simple, &opts)) < 0) {
+        *status = -err;
+        return NULL;
+    }
+    ins->path = opts.path;
+    ins->generation = pathcache_generation();
+    return ins->path;
+}
 
-            int status;
-            waitpid(pid, &status, 0);
-            tcsetpgrp(fdtty, shell_pid); // Terminal zurückholen
+/*
+ * Führt einen einfachen Befehl aus. OP_FLAG_LAST heißt: danach wird in diesem Befehl nichts mehr ausgeführt.
+ * Ist zusätzlich die Eingabe zu Ende (nur -c / Skript), ersetzt der Befehl die Shell per exec,
+ * statt einen weiteren Prozess zu starten und darauf zu warten.
+ */
+static int do_execute_simple(Instruction *ins){
+    SimpleCommand *cmd_s = ins->u.simple;
+    const Builtin *builtin = ins->builtin; // Builtins laufen ohne Prozessstart, gebunden beim Übersetzen
+    int background = cmd_s->background;
+    const char *path;
+    ProcSubs ps;
+    int res;
 
-            statuslist_update(pid, status);
+    // <(...) und >(...) laufen schon, bevor der Befehl startet
+    if (procsubs_start(&ps, &cmd_s, 1) < 0) {
+        return 1;
+    }
+    // cat/tee blockieren die Shell und ließen sich dort nicht mit Ctrl-C abbrechen
+    // (SIGINT wird ignoriert): interaktiv, im Hintergrund und mit run läuft das Programm
+    if (builtin != NULL && (builtin->stage == NULL || (!shell_interactive && !background && exec_options.run == NULL))) {
+        res = builtin_run(builtin, cmd_s);
+    } else if ((ins->flags & OP_FLAG_LAST) && !background && !shell_interactive && shell_input_done
+               && !exec_options.time && exec_options.run == NULL && ps.count == 0) {
+        // run nur im Kind: scheitert das exec, bliebe die Shell sonst gebremst/gebunden
+        return exec_simple_command(cmd_s); // kehrt nur im Fehlerfall zurück
+    } else if ((path = instruction_path(ins, &res)) != NULL) {
+        res = execute_fork(cmd_s, path, background, ps.fds, ps.count); // Für alle anderen Befehle wird ein Prozess gestartet
+        if (res < 0) {
+            ins->path = NULL; // z. B. inzwischen gelöscht: beim nächsten Mal neu suchen
+            res = -res;       // 127/126 wie in sh
         }
     }
+    procsubs_finish(&ps, !background);
+    return res;
+}
+
+/*
+ * Pipes: alle Stufen eines Fensters bekommen ihre Pipes vorab und werden dann
+ * gleichzeitig gestartet, bei langen Pipes auf mehrere Threads verteilt.
+ * posix_spawn blockiert den aufrufenden Thread bis zum exec des Kindes, mit
+ * mehreren Threads überlappen sich diese Wartezeiten. Die Threads erben die
+ * Signalmaske (SIGCHLD bleibt blockiert) und fassen weder pathcache noch
+ * Statusliste an; das erledigt der Hauptthread davor bzw. danach.
+ */
+#define PIPE_SPAWN_MAX_THREADS 8
+#define PIPE_SPAWN_PER_THREAD 32   // weniger Stufen pro Thread lohnen den Thread nicht
+#define PIPE_FD_RESERVE 64         // Deskriptoren, die neben den Pipes frei bleiben
+#define PIPE_WINDOW_MAX 128        // Stufen, deren Pipes gleichzeitig offen sind
+
+typedef struct {
+    SimpleCommand **stages;
+    SpawnOptions *opts;
+    pid_t *pids;
+    int from, to, step;   // startet die Stufen from, from + step, ... < to
+} SpawnRange;
+
+static void *spawn_range(void *arg) {
+    SpawnRange *r = arg;
+    for (int i = r->from; i < r->to; i += r->step) {
+        if (r->opts[i].path != NULL)
+            r->pids[i] = spawn_simple_command(r->stages[i], &r->opts[i]);
+    }
+    return NULL;
+}
+
+/* Startet die Stufen [from, to), bei genug Stufen parallel */
+static void spawn_window(SimpleCommand **stages, SpawnOptions *opts, pid_t *pids, int from, int to) {
+    static long cpus = 0;
+    pthread_t threads[PIPE_SPAWN_MAX_THREADS];
+    int created[PIPE_SPAWN_MAX_THREADS];
+    SpawnRange ranges[PIPE_SPAWN_MAX_THREADS];
+    int count = to - from;
+    int nthreads;
+
+    if (cpus == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus < 1) cpus = 1;
+    }
+    nthreads = count / PIPE_SPAWN_PER_THREAD;
+    if (nthreads > cpus) nthreads = cpus;
+    if (nthreads > PIPE_SPAWN_MAX_THREADS) nthreads = PIPE_SPAWN_MAX_THREADS;
+    if (nthreads < 1) nthreads = 1;
+
+    for (int t = 0; t < nthreads; t++) {
+        ranges[t] = (SpawnRange){ stages, opts, pids, from + t, to, nthreads };
+    }
+    // Thread 0 ist der Hauptthread selbst; scheitert pthread_create, übernimmt er den Teil
+    for (int t = 1; t < nthreads; t++) {
+        created[t] = pthread_create(&threads[t], NULL, spawn_range, &ranges[t]) == 0;
+        if (!created[t])
+            spawn_range(&ranges[t]);
+    }
+    spawn_range(&ranges[0]);
+    for (int t = 1; t < nthreads; t++) {
+        if (created[t])
+            pthread_join(threads[t], NULL);
+    }
+}
+
+/*
+ * Stufen pro Fenster: jede hält eine Pipe (2 fds) offen, bis sie gestartet ist.
+ * Jedes Kind erbt die ganze fd-Tabelle und schließt beim exec alle O_CLOEXEC-fds,
+ * zu große Fenster machen den Start also quadratisch teurer (5000 Stufen auf
+ * einmal: 6,4 s, in Fenstern zu 128: 2,6 s). Ohne freie fds wird es kleiner.
+ */
+static int pipe_window() {
+    struct rlimit lim;
+    long budget = 1024;
+
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0)
+        budget = lim.rlim_cur == RLIM_INFINITY ? 1 << 20 : (long)lim.rlim_cur;
+    budget = (budget - PIPE_FD_RESERVE) / 2;
+    if (budget > PIPE_WINDOW_MAX)
+        budget = PIPE_WINDOW_MAX;
+    return budget < 2 ? 2 : (int)budget;
+}
+
+/*
+ * Builtins mit Stufen-Variante (cat, tee) laufen mitten in einer Pipe als Thread
+ * der Shell statt als Prozess. Der Thread besitzt seine beiden fds und schließt
+ * sie am Ende, damit die Nachbarstufen EOF bzw. EPIPE sehen.
+ */
+typedef struct {
+    StageFunc func;     // NULL: Stufe wird als Prozess gestartet
+    const Builtin *builtin; // Builtin ohne Thread: läuft in einem Kind (builtin_spawn)
+    char **argv;
+    int fd_in, fd_out;
+    int started;
+    pthread_t thread;
+} StageThread;
+
+static void *stage_thread(void *arg) {
+    StageThread *st = arg;
+    sigset_t set;
+
+    // Ohne Leser soll write mit EPIPE scheitern, statt die ganze Shell zu beenden
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    st->func(st->argv, st->fd_in, st->fd_out);
+    close(st->fd_in);
+    close(st->fd_out);
+    return NULL;
+}
+
+/*
+ * Startet den Thread der Stufe <cmd_s>; <opts> enthält ihre Pipe-Enden, die der Thread
+ * übernimmt (Umleitungen gewinnen). Rückgabe: 0 oder -1 (fds sind dann geschlossen).
+ */
+static int stage_start(StageThread *st, SimpleCommand *cmd_s, SpawnOptions *opts) {
+    int redir_in, redir_out;
+
+    if (redirections_open(cmd_s, &redir_in, &redir_out) < 0) {
+        if (opts->fd_in != -1) close(opts->fd_in);
+        if (opts->fd_out != -1) close(opts->fd_out);
+        return -1;
+    }
+    if (redir_in != -1) {
+        if (opts->fd_in != -1) close(opts->fd_in);
+        opts->fd_in = redir_in;
+    }
+    if (redir_out != -1) {
+        if (opts->fd_out != -1) close(opts->fd_out);
+        opts->fd_out = redir_out;
+    }
+    // Eigene Kopie von STDIN: ein Builtin am Ende der Pipe biegt fd 0 gleich um
+    if (opts->fd_in == -1)
+        opts->fd_in = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 10);
 
+    st->argv = cmd_s->command_tokens;
+    st->fd_in = opts->fd_in;
+    st->fd_out = opts->fd_out;
+    if (pthread_create(&st->thread, NULL, stage_thread, st) != 0) {
+        fprintf(stderr, "%s: cannot start thread\n", st->argv[0]);
+        close(st->fd_in);
+        close(st->fd_out);
+        return -1;
+    }
+    st->started = 1;
     return 0;
 }
 
-static int do_execute_simple(SimpleCommand *cmd_s, int background){
-    if (cmd_s==NULL){ // Falls der Befehl leer ist (was nicht passieren sollte), einfach zurückkehren
-        return 0;
+
+/* Gibt dem Befehl <cmd_s> seine /dev/fd/N mit */
+static void procsubs_keep(const ProcSubs *ps, SimpleCommand *cmd_s, SpawnOptions *opts) {
+    int first = 0;
+
+    if (ps == NULL)
+        return;
+    while (first < ps->count && ps->owners[first] != cmd_s)
+        first++;
+    opts->keep_fds = ps->fds + first;
+    opts->keep_count = 0;
+    while (first + opts->keep_count < ps->count && ps->owners[first + opts->keep_count] == cmd_s)
+        opts->keep_count++;
+}
+
+/*
+ * Eine gestartete Pipe. execute_pipe() wartet gleich auf sie, eine Prozess-Substitution
+ * erst nach dem äußeren Befehl.
+ */
+typedef struct {
+    int n;
+    SimpleCommand **stages;
+    SpawnOptions *opts;
+    pid_t *pids;           // nach pipe_launch() dicht gepackt: die gestarteten Prozesse
+    int *statuses;
+    StageThread *threads;
+    Profile *profile;
+    const Builtin *builtin; // letzte Stufe läuft in der Shell und liest last_fd
+    int last_fd;
+    int started;           // gültige Einträge in pids
+    int last_started;      // letzte Stufe läuft als Prozess
+    int last_error;        // sonst: 127/126, wenn sie nicht gestartet werden konnte, oder 1
+    pid_t pgid;
+} PipeRun;
+
+static void pipe_init(PipeRun *run, Command *cmd) {
+    int n = cmd->command_sequence->command_list_len;
+    int i = 0;
+
+    memset(run, 0, sizeof(*run));
+    run->n = n;
+    run->stages = malloc(n * sizeof(SimpleCommand *));
+    run->opts = malloc(n * sizeof(SpawnOptions));
+    run->pids = malloc(n * sizeof(pid_t));
+    run->statuses = malloc(n * sizeof(int));
+    run->threads = calloc(n, sizeof(StageThread));
+    run->last_fd = -1;
+    run->pgid = shell_interactive ? 0 : getpgrp();
+    if (run->stages == NULL || run->opts == NULL || run->pids == NULL || run->statuses == NULL || run->threads == NULL) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
     }
-    if (strcmp(cmd_s->command_tokens[0],"exit")==0){ // Wenn der Benutzer "exit" eingibt, Shell sofort verlassen
-        exit(0);
+    for (List *lst = cmd->command_sequence->command_list; lst != NULL; lst = lst->tail) {
+        run->stages[i++] = (SimpleCommand *)lst->head;
     }
-    else if (strcmp(cmd_s->command_tokens[0], "cd") == 0) { // Prüfen, ob der eingegebene Befehl "cd" ist
-        char *path = cmd_s->command_tokens[1];  // Pfadparameter lesen
-    
-        if (path == NULL) { // Wenn kein Argument übergeben wurde (z. B. nur "cd"), HOME verwenden
-            path = getenv("HOME");
+}
+
+static void pipe_free(PipeRun *run) {
+    free(run->stages);
+    free(run->opts);
+    free(run->pids);
+    free(run->statuses);
+    free(run->threads);
+}
+
+/*
+ * Startet die Stufen und trägt sie in die Statusliste ein. <in_shell> = 0 (Prozess-
+ * Substitution): jede Stufe ist ein Prozess, ohne Builtin am Ende, Threads und profile.
+ * <fd_in>/<fd_out> werden Ein- und Ausgabe der ganzen Pipe (-1 = unverändert) und hier
+ * geschlossen; <ps> liefert die /dev/fd/N der Stufen (NULL = keine).
+ */
+static void pipe_launch(PipeRun *run, int in_shell, int fd_in, int fd_out, const ProcSubs *ps) {
+    int n = run->n;
+    SimpleCommand **stages = run->stages;
+    SpawnOptions *opts = run->opts;
+    pid_t *pids = run->pids;
+    StageThread *threads = run->threads;
+    pid_t pgid = run->pgid;
+    int last_fd = fd_in;
+    int i;
+
+    // Ein Builtin als letzte Stufe läuft in der Shell selbst (z. B. "find | xargs ...")
+    // und liest aus der Pipe; die übrigen Stufen laufen dabei schon. Nur wer das
+    // erlaubt: "echo x | exit 3" darf die Shell nicht beenden
+    run->builtin = in_shell ? builtin_for(stages[n - 1]->command_tokens) : NULL;
+    if (run->builtin != NULL && !(run->builtin->pipe_flags & BUILTIN_PIPE_LAST))
+        run->builtin = NULL;
+    int spawn_count = run->builtin != NULL ? n - 1 : n;
+
+    // Pfade und argv im Hauptthread prüfen (pathcache ist nicht threadsicher).
+    // Eine Stufe, die nicht startet, bekommt trotzdem ihre Pipes, die gleich
+    // wieder geschlossen werden, damit die Nachbarstufen EOF sehen
+    for (i = 0; i < spawn_count; i++) {
+        opts[i] = (SpawnOptions){ .fd_in = -1, .fd_out = -1, .pgid = pgid, .run = exec_options.run };
+        pids[i] = -1;
+        // Interaktiv gehört das Terminal gleich der Pipe, die erste Stufe muss ein Prozess sein;
+        // mit run sollen die Einstellungen für jede Stufe gelten, also auch Prozesse
+        const Builtin *inner = in_shell ? builtin_for(stages[i]->command_tokens) : NULL;
+        if (inner != NULL && inner->stage != NULL && (i > 0 || !shell_interactive) && exec_options.run == NULL) {
+            threads[i].func = inner->stage;
+            continue;
         }
-    
-        // Prüfen, ob Pfad gültig ist
-        if (path == NULL || strlen(path) == 0) {
-            fprintf(stderr, "cd: invalid path\n");
-            return 1;
+        procsubs_keep(ps, stages[i], &opts[i]);
+        if (inner != NULL && !(inner->pipe_flags & BUILTIN_PIPE_EXEC) && exec_options.run == NULL) {
+            threads[i].builtin = inner; // opts[i].path bleibt NULL, spawn_window() überspringt die Stufe
+            continue;
         }
-    
-        if (chdir(path) != 0) {
-            perror("cd");
+        int err = spawn_prepare(stages[i], &opts[i]);
+        if (err < 0)
+            pids[i] = err; // Status für pipe_wait(), falls es die letzte Stufe ist
+    }
+
+    long size = exec_options.pipe_size > 0 ? exec_options.pipe_size : pipe_size;
+    int window = pipe_window();
+    Profile *profile = NULL;
+    if (in_shell && exec_options.profile && n > PROFILE_MAX_STAGES) {
+        fprintf(stderr, "-bshell: profile: at most %d stages, running without profile\n", PROFILE_MAX_STAGES);
+    } else if (in_shell && exec_options.profile) {
+        profile = profile_start(n, exec_options.profile_interval);
+    }
+    for (int start = 0, end; start < spawn_count; start = end) {
+        end = start + window < spawn_count ? start + window : spawn_count;
+
+        for (i = start; i < end; i++) {
+            int fd_pipe[2];
+
+            opts[i].fd_in = last_fd;
+            last_fd = -1;
+            if (i == n - 1) {
+                opts[i].fd_out = fd_out;
+                fd_out = -1;
+            } else {
+                if (pipe2(fd_pipe, O_CLOEXEC) == -1) {
+                    perror("pipe");
+                    exit(EXIT_FAILURE);
+                }
+                // Größerer Puffer: weniger Kontextwechsel zwischen den Stufen. Scheitert es
+                // (z. B. pipe-user-pages-soft erreicht), bleibt es bei der Vorgabe
+                if (size > 0)
+                    fcntl(fd_pipe[1], F_SETPIPE_SZ, (int)size);
+                opts[i].fd_out = fd_pipe[1];
+                last_fd = fd_pipe[0];
+                // profile: die Shell hängt ein Relay dazwischen, das mitzählt
+                if (profile != NULL)
+                    last_fd = profile_relay(profile, i, fd_pipe[0], size);
+            }
+        }
+
+        // Mit Jobkontrolle legt die erste gestartete Stufe die Prozessgruppe an,
+        // erst danach können die anderen gleichzeitig beitreten
+        int first = start;
+        while (pgid == 0 && first < end) {
+            if (threads[first].builtin != NULL)
+                pids[first] = builtin_spawn(threads[first].builtin, stages[first], &opts[first]);
+            else if (opts[first].path != NULL)
+                pids[first] = spawn_simple_command(stages[first], &opts[first]);
+            if (pids[first] > 0) {
+                pgid = pids[first];
+                for (i = first + 1; i < spawn_count; i++)
+                    opts[i].pgid = pgid;
+            }
+            first++;
+        }
+        spawn_window(stages, opts, pids, first, end);
+        // fork nur im Hauptthread und erst nach den Spawn-Threads
+        for (i = first; i < end; i++) {
+            if (threads[i].builtin != NULL)
+                pids[i] = builtin_spawn(threads[i].builtin, stages[i], &opts[i]);
+        }
+        for (i = start; i < end; i++) {
+            if (threads[i].func != NULL)
+                stage_start(&threads[i], stages[i], &opts[i]);
+        }
+
+        // Elternseite der Pipes schließen (außer bei Threads, sie gehören ihnen);
+        // last_fd gehört schon zum nächsten Fenster
+        for (i = start; i < end; i++) {
+            if (threads[i].func != NULL)
+                continue;
+            if (opts[i].fd_in != -1) close(opts[i].fd_in);
+            if (opts[i].fd_out != -1) close(opts[i].fd_out);
         }
-        return 0;
     }
-/* do not modify this */
-#ifndef NOLIBREADLINE
-     else if (strcmp(cmd_s->command_tokens[0],"hist")==0){ // Wenn "hist", dann Verlauf anzeigen (wenn durch readline unterstützt)
-        return builtin_hist(cmd_s->command_tokens);
-#endif /* NOLIBREADLINE */
+    // Nur ohne gestartete Stufe übrig (leere Pipe gibt es nicht, aber sicher ist sicher)
+    if (fd_out != -1) close(fd_out);
 
-    } 
-    else if (strcmp(cmd_s->command_tokens[0], "status") == 0){
-        statuslist_print_and_cleanup();  // Funktion in statuslist.c aufrufen
-        return 0;
-    } else { // Für alle anderen Befehle wird fork() verwendet
-        return execute_fork(cmd_s, background);
+    // Gestartete Stufen eintragen (dicht gepackt)
+    run->last_started = run->builtin == NULL && pids[n - 1] > 0;
+    run->last_error = run->builtin == NULL && pids[n - 1] < -1 ? -pids[n - 1] : 1;
+    run->started = 0;
+    for (i = 0; i < spawn_count; i++) {
+        if (profile != NULL)
+            profile_stage(profile, i, stages[i]->command_tokens[0], pids[i]);
+        if (pids[i] > 0) {
+            statuslist_add(pids[i], pgid, stages[i]->command_tokens[0]);
+            pids[run->started++] = pids[i];
+        }
+    }
+    for (i = 0; i < run->started; i++) {
+        run->statuses[i] = 0;
     }
-    fprintf(stderr, "This should never happen!\n"); // Notfallmeldung, falls kein Fall zutrifft
-    exit(1);
+    run->profile = profile;
+    run->last_fd = last_fd;
+    run->pgid = pgid;
 }
 
 /*
- * Prüft, ob der Befehl im Vordergrund oder Hintergrund ausgeführt werden soll.
- *
- * Bei Sequenzen wird das &-Zeichen am Ende geprüft.
- *
- * Rückgabewerte:
- *      0 → Vordergrund
- *      1 → Hintergrund
+ * Wartet im Vordergrund auf die Pipe, ein Builtin am Ende läuft währenddessen.
+ * Rückgabe: Status der letzten Stufe
  */
-int check_background_execution(Command * cmd){
-    List * lst = NULL;
-    int background =0;
-    switch(cmd->command_type){
-    case C_SIMPLE:
-        lst = cmd->command_sequence->command_list;
-        background = ((SimpleCommand*) lst->head)->background;
-        break;
-    case C_OR:
-    case C_AND:
-    case C_PIPE:
-    case C_SEQUENCE:
-        /*
-         * Letzter Befehl in der Liste entscheidet über foreground/hintergrund
-         */
-        lst = cmd->command_sequence->command_list;
-        while (lst !=NULL){ // Durchläuft alle Befehle in der Liste. Z. B. "ls ; echo hallo &"
-            background = ((SimpleCommand*) lst->head)->background;
-            lst=lst->tail;
+static int pipe_wait(PipeRun *run) {
+    int n = run->n;
+    int res = 0;
+
+    if (run->pgid != 0)
+        give_terminal(run->pgid);
+    eventloop_watch(run->pids, run->started, run->statuses);
+    if (run->builtin != NULL) {
+        res = builtin_run_input(run->builtin, run->stages[n - 1], run->last_fd);
+    }
+    eventloop_wait_watched(0);
+    eventloop_unwatch();
+    for (int i = 0; i < n; i++) {
+        if (run->threads[i].started)
+            pthread_join(run->threads[i].thread, NULL);
+    }
+    if (run->profile != NULL) {
+        if (run->builtin != NULL)
+            profile_stage(run->profile, n - 1, run->stages[n - 1]->command_tokens[0], -1);
+        profile_finish(run->profile);
+    }
+    give_terminal(shell_pid);
+
+    if (run->builtin == NULL) {
+        // Status der Pipe = Status der letzten Stufe, 127 wenn sie nicht gefunden wurde
+        res = run->last_started ? exit_status(run->statuses[run->started - 1]) : run->last_error;
+    }
+    return res;
+}
+
+/* Zählt die Prozess-Substitutionen in Argumenten und Umleitungen von <cmd_s> */
+static int procsub_count(SimpleCommand *cmd_s) {
+    int count = 0;
+
+    for (int i = 0; i < cmd_s->command_token_counter; i++) {
+        if (cmd_s->command_spans[i].flags & TOKEN_PROCSUB)
+            count++;
+    }
+    for (List *r = cmd_s->redirections; r != NULL; r = r->tail) {
+        Redirection *redirection = r->head;
+        if (redirection->r_type == R_FILE && (redirection->r_span.flags & TOKEN_PROCSUB))
+            count++;
+    }
+    return count;
+}
+
+/* Stufen des inneren Befehls, 0 wenn er keine Pipe ist (procsub_launch() lehnt ihn ab) */
+static int procsub_stages(ProcSubstitution *sub) {
+    Command *inner = sub->command;
+
+    if (inner->command_type != C_SIMPLE && inner->command_type != C_PIPE)
+        return 0;
+    return inner->command_sequence->command_list_len;
+}
+
+/* Startet eine Prozess-Substitution für <owner>; 0 oder -1 (Meldung ausgegeben) */
+static int procsub_launch(ProcSubs *ps, ProcSubstitution *sub, SimpleCommand *owner) {
+    Command *inner = sub->command;
+    PipeRun run;
+    int fd_pipe[2];
+    int keep;
+
+    if (inner->command_type != C_SIMPLE && inner->command_type != C_PIPE) {
+        fprintf(stderr, "-bshell: process substitution: only a command or a pipeline\n");
+        return -1;
+    }
+    for (List *lst = inner->command_sequence->command_list; lst != NULL; lst = lst->tail) {
+        if (procsub_count(lst->head) > 0) {
+            fprintf(stderr, "-bshell: process substitution: nesting is not supported\n");
+            return -1;
         }
-        break;
-    case C_EMPTY:
-    default:
-        break;
     }
-    return background;
+    if (pipe2(fd_pipe, O_CLOEXEC) == -1) {
+        perror("-bshell: process substitution");
+        return -1;
+    }
+
+    // <(...): die Pipe schreibt in die Shell-Seite, >(...): sie liest von dort
+    pipe_init(&run, inner);
+    if (sub->output) {
+        keep = fd_pipe[1];
+        pipe_launch(&run, 0, fd_pipe[0], -1, NULL);
+    } else {
+        keep = fd_pipe[0];
+        pipe_launch(&run, 0, -1, fd_pipe[1], NULL);
+    }
+    memcpy(ps->pids + ps->pid_count, run.pids, run.started * sizeof(pid_t));
+    ps->pid_count += run.started;
+    pipe_free(&run);
+
+    ps->fds[ps->count] = keep;
+    ps->owners[ps->count] = owner;
+    ps->count++;
+    snprintf(sub->path, sizeof(sub->path), "/dev/fd/%d", keep);
+    return 0;
 }
 
-/* Startet die vollständige Ausführung des Befehls, egal ob einfach oder komplex */
-int execute(Command * cmd){
-    unquote_command(cmd);
-
-    int res=0;
-    List * lst=NULL;
-
-    int execute_in_background=check_background_execution(cmd); // Prüfen, ob am Ende ein & steht
-    switch(cmd->command_type){
-    case C_EMPTY:
-        break;
-    case C_SIMPLE:
-        res=do_execute_simple((SimpleCommand*) cmd->command_sequence->command_list->head, execute_in_background);
-        fflush(stderr); // Fehlerausgabe sofort erzwingen
-        break;
-
-    case C_OR:
-    case C_AND:
-    {
-        List *lst = cmd->command_sequence->command_list;
-        int last_result = 0;
-    
-        while (lst != NULL) {
-            if (lst->head == NULL) {
-                fprintf(stderr, "Error : empty list\n");
-                break;
-            }
-    
-            SimpleCommand *cmd_s = (SimpleCommand *)lst->head;
-
-            // Entscheidet ob ausgeführt wird
-            if (
-                lst == cmd->command_sequence->command_list ||  // Erste Anweisung wird sowieso ausgeführt
-                (cmd->command_type == C_AND && last_result == 0) ||  // && → nur wenn vorheriger Erfolg
-                (cmd->command_type == C_OR && last_result != 0) // || → nur wenn vorheriger Fehler
-            ) {
-                last_result = execute_fork(cmd_s, 0); // Ergebnis merken
-            }
-    
-            lst = lst->tail;
+/*
+ * Wartet auf die Prozess-Substitutionen (<wait> = 0: lässt sie als Hintergrundjobs weiterlaufen),
+ * nachdem die Shell ihre Enden geschlossen hat
+ */
+static void procsubs_finish(ProcSubs *ps, int wait) {
+    if (ps->fds == NULL)
+        return;
+    for (int i = 0; i < ps->count; i++) {
+        close(ps->fds[i]);
+    }
+    if (wait)
+        eventloop_wait_watched(0);
+    eventloop_unwatch();
+    free(ps->fds);
+    free(ps->owners);
+    free(ps->pids);
+    free(ps->statuses);
+    ps->fds = NULL;
+}
+
+/*
+ * Startet die Prozess-Substitutionen der Befehle <cmds> und meldet ihre Prozesse
+ * als Gruppe bei der eventloop an. Ohne Substitution bleibt ps->count = 0.
+ * Rückgabe: 0 oder -1 (Meldung ausgegeben, bereits gestartete sind beendet)
+ */
+static int procsubs_start(ProcSubs *ps, SimpleCommand **cmds, int n) {
+    int total = 0, stages = 0;
+
+    memset(ps, 0, sizeof(*ps));
+    for (int c = 0; c < n; c++) {
+        total += procsub_count(cmds[c]);
+    }
+    if (total == 0)
+        return 0;
+    for (int c = 0; c < n; c++) {
+        for (int i = 0; i < cmds[c]->command_token_counter; i++) {
+            if (cmds[c]->command_spans[i].flags & TOKEN_PROCSUB)
+                stages += procsub_stages(command_procsub_get(cmds[c]->command_spans[i]));
         }
-        break;
-    }
-    case C_SEQUENCE:
-        /** Iteration durch die Befehlsliste **/
-        lst = cmd->command_sequence->command_list;
-        while (lst !=NULL){
-            SimpleCommand * cmd = (SimpleCommand*)lst->head; // Befehl holen
-            execute_fork(cmd, 0); // Vordergrundausführung
-            lst=lst->tail; // Nächster Befehl
+        for (List *r = cmds[c]->redirections; r != NULL; r = r->tail) {
+            Redirection *redirection = r->head;
+            if (redirection->r_type == R_FILE && (redirection->r_span.flags & TOKEN_PROCSUB))
+                stages += procsub_stages(command_procsub_get(redirection->r_span));
         }
-        break;
+    }
+    ps->fds = malloc(total * sizeof(int));
+    ps->owners = malloc(total * sizeof(SimpleCommand *));
+    // +1: abgelehnte innere Befehle zählen 0 Stufen, malloc(0) darf NULL liefern
+    ps->pids = malloc((stages + 1) * sizeof(pid_t));
+    ps->statuses = calloc(stages + 1, sizeof(int));
+    if (ps->fds == NULL || ps->owners == NULL || ps->pids == NULL || ps->statuses == NULL) {
+        perror("-bshell: process substitution");
+        exit(EXIT_FAILURE);
+    }
 
-    case C_PIPE: {
-        List *lst = cmd->command_sequence->command_list;
-        int fd_pipe[2];
-        int last_fd = -1;
-        pid_t pgid = 0;
-        pid_t pids[256]; // feste Größe (max. 256 Befehle in einer Pipe)
-        int i = 0;
+    int res = 0;
+    for (int c = 0; c < n && res == 0; c++) {
+        for (int i = 0; i < cmds[c]->command_token_counter && res == 0; i++) {
+            if (cmds[c]->command_spans[i].flags & TOKEN_PROCSUB)
+                res = procsub_launch(ps, command_procsub_get(cmds[c]->command_spans[i]), cmds[c]);
+        }
+        for (List *r = cmds[c]->redirections; r != NULL && res == 0; r = r->tail) {
+            Redirection *redirection = r->head;
+            if (redirection->r_type == R_FILE && (redirection->r_span.flags & TOKEN_PROCSUB))
+                res = procsub_launch(ps, command_procsub_get(redirection->r_span), cmds[c]);
+        }
+    }
+    eventloop_watch(ps->pids, ps->pid_count, ps->statuses);
+    if (res < 0) {
+        procsubs_finish(ps, 1);
+        return -1;
+    }
+    return 0;
+}
 
-        while (lst != NULL) {
-            SimpleCommand *cmd_s = (SimpleCommand *)lst->head;
+static int execute_pipe(Command *cmd) {
+    PipeRun run;
+    ProcSubs ps;
+    int res;
 
-            if (lst->tail != NULL) {
-                if (pipe(fd_pipe) == -1) {
-                    perror("pipe");
-                    exit(EXIT_FAILURE);
-                }
-            }
+    pipe_init(&run, cmd);
+    if (procsubs_start(&ps, run.stages, run.n) < 0) {
+        pipe_free(&run);
+        return 1;
+    }
+    pipe_launch(&run, 1, -1, -1, &ps);
+    res = pipe_wait(&run);
+    procsubs_finish(&ps, 1);
+    pipe_free(&run);
+    return res;
+}
 
-            pid_t pid = fork();
+/*
+ * Legt <fd> auf <target> (0 oder 1) und liefert eine Kopie des alten Deskriptors
+ * für restore_fd(), -1 wenn <fd> = -1 (keine Umleitung in diese Richtung)
+ */
+static int redirect_fd(int target, int fd) {
+    int saved;
 
-            if (pid == 0) {
-                if (pgid == 0) pgid = getpid();
-                setpgid(0, pgid);
+    if (fd == -1)
+        return -1;
+    saved = fcntl(target, F_DUPFD_CLOEXEC, 10);
+    dup2(fd, target);
+    close(fd);
+    return saved;
+}
 
-                signal(SIGINT, SIG_DFL);
-                signal(SIGTTOU, SIG_DFL);
+static void restore_fd(int target, int saved) {
+    if (saved == -1)
+        return;
+    dup2(saved, target);
+    close(saved);
+}
 
-                if (last_fd != -1) {
-                    dup2(last_fd, STDIN_FILENO);
-                    close(last_fd);
-                }
+/* Umleitungen einer Gruppe, die bis zu ihrem OP_RESTORE gelten */
+typedef struct {
+    int saved_in, saved_out;
+    ProcSubs ps;
+} RedirectFrame;
 
-                if (lst->tail != NULL) {
-                    close(fd_pipe[0]);
-                    dup2(fd_pipe[1], STDOUT_FILENO);
-                    close(fd_pipe[1]);
-                }
+static void frame_restore(RedirectFrame *frame) {
+    fflush(stdout);
+    restore_fd(STDIN_FILENO, frame->saved_in);
+    restore_fd(STDOUT_FILENO, frame->saved_out);
+    procsubs_finish(&frame->ps, 1);
+}
 
-                // Redirection behandeln
-                List *redirige = cmd_s->redirections;
-                while (redirige != NULL) {
-                    Redirection *redir = (Redirection *)redirige->head;
-                    int fd;
-
-                    if (redir->r_type == R_FILE) {
-                        if (redir->r_mode == M_WRITE)
-                            fd = open(redir->u.r_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                        else if (redir->r_mode == M_APPEND)
-                            fd = open(redir->u.r_file, O_WRONLY | O_CREAT | O_APPEND, 0644);
-                        else
-                            fd = open(redir->u.r_file, O_RDONLY);
-
-                        if (fd < 0) {
-                            fprintf(stderr, "%s: %s: %s\n", cmd_s->command_tokens[0], redir->u.r_file, strerror(errno));
-                            exit(1);
-                        }
-
-                        if (redir->r_mode == M_READ)
-                            dup2(fd, STDIN_FILENO);
-                        else
-                            dup2(fd, STDOUT_FILENO);
-
-                        close(fd);
-                    }
-
-                    redirige = redirige->tail;
-                }
+/*
+ * Ctrl-C in einer Schleife beendet wie in der bash die ganze Zeile. Ein Kind im
+ * Vordergrund bekommt das Signal selbst (Status 128 + SIGINT); laufen nur Builtins,
+ * hat die Shell das Terminal und merkt es sich hier, statt es zu ignorieren.
+ */
+static volatile sig_atomic_t loop_interrupted = 0;
 
-                execvp(cmd_s->command_tokens[0], cmd_s->command_tokens);
-                perror("exec");
-                exit(1);
-            } else if (pid > 0) {
-                if (pgid == 0) pgid = pid;
-                setpgid(pid, pgid);
+static void note_interrupt(int sig) {
+    (void) sig;
+    loop_interrupted = 1;
+}
 
-                pids[i++] = pid;
-                statuslist_add(pid, pgid, cmd_s->command_tokens[0]);
+/*
+ * Subshell "( ... )": das Kind erbt das Programm und arbeitet es ab der nächsten
+ * Instruktion ab, bis OP_EXIT. Es hat keine Jobkontrolle mehr, seine Programme
+ * bleiben in seiner Prozessgruppe, die interaktiv das Terminal bekommt.
+ */
+static int in_subshell = 0;
 
-                if (last_fd != -1)
-                    close(last_fd);
+/* Rückgabe: 0 im Kind, pid des Kindes in der Shell, -1 bei Fehler */
+static pid_t subshell_start() {
+    pid_t pid;
 
-                if (lst->tail != NULL) {
-                    close(fd_pipe[1]);
-                    last_fd = fd_pipe[0];
-                }
-            } else {
-                perror("fork");
-                exit(1);
-            }
+    fflush(stdout); // sonst gibt das Kind den Puffer der Shell noch einmal aus
+    fflush(stderr);
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        if (shell_interactive) {
+            setpgid(0, 0);
+            tcsetpgrp(fdtty, getpid());
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTTOU, SIG_DFL);
+            signal(SIGTSTP, SIG_DFL);
+        }
+        shell_interactive = 0;
+        shell_input_done = 1; // nach dem Inhalt kommt für das Kind nichts mehr: exec erlaubt
+        in_subshell = 1;
+        eventloop_forked();
+        return 0;
+    }
+    if (shell_interactive)
+        setpgid(pid, pid);
+    statuslist_add(pid, shell_interactive ? pid : getpgrp(), "(");
+    return pid;
+}
+
+static void subshell_exit(int status) {
+    fflush(stdout);
+    fflush(stderr);
+    _exit(status & 0xff);
+}
+
+/*
+ * Führt das übersetzte Programm aus (Präfixe sind schon entfernt). <status> ist
+ * der Status des zuletzt ausgeführten Befehls, auf ihn prüfen die Sprünge.
+ */
+static int execute_program(Program *prog) {
+    RedirectFrame *frames = NULL;
+    int *slots = NULL;
+    struct sigaction saved_interrupt;
+    int depth = 0;
+    int status = 0;
+    int pc = 0;
 
-            lst = lst->tail;
+    if (prog->depth > 0) {
+        frames = malloc(prog->depth * sizeof(RedirectFrame));
+        if (frames == NULL) {
+            perror("execute");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (prog->slots > 0) {
+        slots = malloc(prog->slots * sizeof(int));
+        if (slots == NULL) {
+            perror("execute");
+            exit(EXIT_FAILURE);
+        }
+        loop_interrupted = 0;
+        if (shell_interactive) {
+            struct sigaction interrupt = { .sa_handler = note_interrupt, .sa_flags = SA_RESTART };
+            sigemptyset(&interrupt.sa_mask);
+            sigaction(SIGINT, &interrupt, &saved_interrupt);
         }
+    }
+    for (;;) {
+        Instruction *ins = &prog->code[pc++];
 
-        // Auf alle Prozesse in der Pipe warten
-        tcsetpgrp(fdtty, pgid);
-        int status;
+        switch (ins->op) {
+        case OP_SIMPLE:
+            status = do_execute_simple(ins);
+            if (status == 128 + SIGINT)
+                loop_interrupted = 1;
+            break;
+        case OP_PIPE:
+            status = execute_pipe(ins->u.pipe);
+            if (status == 128 + SIGINT)
+                loop_interrupted = 1;
+            break;
+        case OP_JUMP_IF_OK:
+            if (status == 0)
+                pc = ins->target;
+            break;
+        case OP_JUMP_IF_FAIL:
+            if (status != 0)
+                pc = ins->target;
+            break;
+        case OP_REDIRECT: {
+            RedirectFrame *frame = &frames[depth];
+            SimpleCommand *redirect = ins->u.simple;
+            int fd_in, fd_out;
+
+            // Scheitert eine Umleitung, läuft die Gruppe nicht (Status 1)
+            if (procsubs_start(&frame->ps, &redirect, 1) < 0) {
+                status = 1;
+                pc = ins->target;
+                break;
+            }
+            if (redirections_open(redirect, &fd_in, &fd_out) < 0) {
+                procsubs_finish(&frame->ps, 1);
+                status = 1;
+                pc = ins->target;
+                break;
+            }
+            fflush(stdout);
+            frame->saved_in = redirect_fd(STDIN_FILENO, fd_in);
+            frame->saved_out = redirect_fd(STDOUT_FILENO, fd_out);
+            depth++;
+            break;
+        }
+        case OP_RESTORE:
+            frame_restore(&frames[--depth]);
+            break;
+        case OP_JUMP:
+            // Rücksprung einer Schleife: hier (und an ihrem Ende) wird auf Ctrl-C geprüft
+            if (ins->target < pc && loop_interrupted) {
+                status = 128 + SIGINT;
+                pc = prog->len - 1;
+                break;
+            }
+            pc = ins->target;
+            break;
+        case OP_STATUS:
+            status = ins->u.value;
+            break;
+        case OP_SAVE:
+            slots[ins->u.value] = status;
+            break;
+        case OP_LOAD:
+            if (loop_interrupted) {
+                status = 128 + SIGINT;
+                pc = prog->len - 1;
+                break;
+            }
+            status = slots[ins->u.value];
+            break;
+        case OP_SUBSHELL: {
+            pid_t pid = subshell_start();
+            int wstatus;
 
-        for (int j = 0; j < i; j++) {
-            pid_t ret = waitpid(pids[j], &status, 0);
-            if (ret > 0) {
-                statuslist_update(ret, status);
+            if (pid == 0)
+                break;  // Kind: weiter mit dem Inhalt
+            if (pid < 0) {
+                status = 1;
+            } else {
+                give_terminal(pid);
+                eventloop_wait(&pid, 1, &wstatus);
+                give_terminal(shell_pid);
+                status = exit_status(wstatus);
+                if (status == 128 + SIGINT)
+                    loop_interrupted = 1;
             }
+            pc = ins->target;
+            break;
+        }
+        case OP_EXIT:
+            subshell_exit(status);
+            break;
+        case OP_END:
+            // Ctrl-C im Kind einer Subshell springt auch hierher
+            if (in_subshell)
+                subshell_exit(status);
+            // nach einem Abbruch stehen noch Umleitungen offener Gruppen
+            while (depth > 0)
+                frame_restore(&frames[--depth]);
+            if (slots != NULL && shell_interactive)
+                sigaction(SIGINT, &saved_interrupt, NULL);
+            fflush(stderr); // Fehlerausgabe sofort erzwingen
+            free(frames);
+            free(slots);
+            return status;
         }
-        tcsetpgrp(fdtty, shell_pid);
-        break;
     }
+}
+
+/* Startet die vollständige Ausführung des Befehls, egal ob einfach oder komplex */
+int execute(Command * cmd){
+    struct timespec start, end;
+    struct rusage self_before, self_after;
+    UsageSum sum;
+    int res;
 
-    default:
-        printf("[%s] unhandled command type [%i]\n", __func__, cmd->command_type);
-        break;
+    if (strip_prefixes(cmd, &exec_options) < 0) {
+        return 2;
     }
+    if (exec_options.profile && cmd->command_type != C_PIPE) {
+        fprintf(stderr, "-bshell: profile: not a pipeline\n");
+    }
+    Program *prog = program_compile(cmd);
+    if (execute_print_program) {
+        program_print(prog); // genau das Programm, das gleich läuft
+    }
+    if (!exec_options.time) {
+        return execute_program(prog);
+    }
+
+    // time: Kinder über wait4 (eventloop_account), Builtins über die eigene CPU-Zeit der Shell
+    memset(&sum, 0, sizeof(sum));
+    getrusage(RUSAGE_SELF, &self_before);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    eventloop_account(&sum);
+
+    res = execute_program(prog);
+
+    eventloop_account(NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    getrusage(RUSAGE_SELF, &self_after);
+
+    timersub(&self_after.ru_utime, &self_before.ru_utime, &self_after.ru_utime);
+    timersub(&self_after.ru_stime, &self_before.ru_stime, &self_after.ru_stime);
+    timeradd(&sum.utime, &self_after.ru_utime, &sum.utime);
+    timeradd(&sum.stime, &self_after.ru_stime, &sum.stime);
+    sum.minflt += self_after.ru_minflt - self_before.ru_minflt;
+    sum.majflt += self_after.ru_majflt - self_before.ru_majflt;
+    sum.nvcsw += self_after.ru_nvcsw - self_before.ru_nvcsw;
+    sum.nivcsw += self_after.ru_nivcsw - self_before.ru_nivcsw;
+
+    report_time(&start, &end, &sum);
     return res;
-}
\ No newline at end of file
+}
@@ -3,4 +3,16 @@
 
 int execute(Command *);
 
+/* --print-commands: execute() gibt das übersetzte Programm aus, bevor es läuft (ohne time/run-Präfixe) */
+extern int execute_print_program;
+
+/* Puffergröße neuer Pipes in Bytes (Builtin "pipesize"), 0 = Vorgabe des Kernels (64 KiB) */
+extern long pipe_size;
+
+/* Liest eine Größe wie 1048576, 256K oder 1M (0 = Vorgabe), -1 bei ungültiger Eingabe */
+long pipe_size_parse(const char *text);
+
+/* Begrenzt <size> auf /proc/sys/fs/pipe-max-size */
+long pipe_size_clamp(long size);
+
 #endif /* EXECUTE_H */
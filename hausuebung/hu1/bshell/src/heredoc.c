@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "heredoc.h"
+#include "arena.h"
+#include "readlineparsing.h"
+#include "debug.h"
+
+/* Umleitungen der aktuellen Zeile, deren Text noch fehlt (in Reihenfolge der Zeile) */
+typedef struct {
+    Redirection *redir;
+    int is_string;
+} Pending;
+
+static Pending *pending = NULL;
+static int pending_count = 0;
+static int pending_cap = 0;
+
+/* memfds der Zeile, werden nach der Ausführung geschlossen */
+static int *fds = NULL;
+static int fd_count = 0;
+static int fd_cap = 0;
+
+/* Text wird hier gesammelt und dann mit einem einzigen write in das memfd geschrieben */
+static char *body = NULL;
+static size_t body_len = 0;
+static size_t body_cap = 0;
+
+static void * grow(void *array, int *cap, size_t size) {
+    *cap = *cap == 0 ? 8 : *cap * 2;
+    array = realloc(array, *cap * size);
+    if (array == NULL) {
+        perror("heredoc");
+        exit(1);
+    }
+    return array;
+}
+
+static void body_append(const char *text, size_t len) {
+    if (body_len + len > body_cap) {
+        while (body_len + len > body_cap)
+            body_cap = body_cap == 0 ? 4096 : body_cap * 2;
+        body = realloc(body, body_cap);
+        if (body == NULL) {
+            perror("heredoc");
+            exit(1);
+        }
+    }
+    memcpy(body + body_len, text, len);
+    body_len += len;
+}
+
+Redirection * heredoc_redirection(token_span_t word, int is_string) {
+    Redirection *redir = arena_alloc(&parse_arena, sizeof(Redirection));
+
+    redir->r_type = R_FD;
+    redir->r_mode = M_HEREDOC;
+    redir->u.r_fd = -1;
+    redir->r_span = word;
+    if (pending_count == pending_cap)
+        pending = grow(pending, &pending_cap, sizeof(Pending));
+    pending[pending_count++] = (Pending){ redir, is_string };
+    return redir;
+}
+
+/* Schreibt <body> in ein versiegeltes memfd, liefert es (Position 0) oder -1 */
+static int body_to_memfd() {
+    int fd = memfd_create("bshell-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    size_t done = 0;
+
+    if (fd < 0) {
+        perror("heredoc: memfd_create");
+        return -1;
+    }
+    // Die Größe ist bekannt: ein write, bei großen Texten höchstens wenige Wiederholungen
+    while (done < body_len) {
+        ssize_t n = write(fd, body + done, body_len - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            perror("heredoc: write");
+            close(fd);
+            return -1;
+        }
+        done += n;
+    }
+    // Ab jetzt unveränderlich, auch für Kinder, die den Deskriptor erben
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+/* Liest die Zeilen bis zu einer Zeile, die genau <delim> ist */
+static void read_heredoc(const char *delim) {
+    size_t delim_len = strlen(delim);
+    char *line;
+    long len;
+
+    while ((len = yy_read_line(&line)) >= 0) {
+        if ((size_t)len == delim_len && memcmp(line, delim, delim_len) == 0)
+            return;
+        body_append(line, len);
+        body_append("\n", 1);
+    }
+    fprintf(stderr, "-bshell: warning: here-document delimited by end-of-file (wanted `%s')\n", delim);
+}
+
+void heredoc_read_bodies() {
+    for (int i = 0; i < pending_count; i++) {
+        Redirection *redir = pending[i].redir;
+        token_span_t word = redir->r_span;
+
+        body_len = 0;
+        if (pending[i].is_string) {
+            body_append(yy_token_base() + word.offset, word.len);
+            body_append("\n", 1);
+        } else {
+            // Kopie: beim Nachlesen darf der Scanner seinen Puffer verschieben
+            char *delim = strndup(yy_token_base() + word.offset, word.len);
+            if (delim == NULL) {
+                perror("heredoc");
+                exit(1);
+            }
+            read_heredoc(delim);
+            free(delim);
+        }
+
+        redir->u.r_fd = body_to_memfd();
+        if (redir->u.r_fd != -1) {
+            if (fd_count == fd_cap)
+                fds = grow(fds, &fd_cap, sizeof(int));
+            fds[fd_count++] = redir->u.r_fd;
+        }
+    }
+    pending_count = 0;
+}
+
+int heredoc_open(const Redirection *redir) {
+    char path[64];
+    int fd;
+
+    if (redir->u.r_fd < 0) {
+        fprintf(stderr, "-bshell: here-document not available\n");
+        return -1;
+    }
+    // Eigene Dateiposition je Umleitung: über /proc neu öffnen statt dup
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", redir->u.r_fd);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        // ohne /proc: dup, die Position wird dann geteilt und zurückgesetzt
+        fd = fcntl(redir->u.r_fd, F_DUPFD_CLOEXEC, 0);
+        if (fd >= 0)
+            lseek(fd, 0, SEEK_SET);
+    }
+    if (fd < 0)
+        perror("heredoc");
+    return fd;
+}
+
+void heredoc_release() {
+    for (int i = 0; i < fd_count; i++)
+        close(fds[i]);
+    fd_count = 0;
+    pending_count = 0;
+    // Ein einmal sehr großer Text soll nicht dauerhaft Speicher belegen
+    if (body_cap > (1 << 20)) {
+        free(body);
+        body = NULL;
+        body_cap = 0;
+    }
+}
@@ -0,0 +1,35 @@
+/*
+ * heredoc.h
+ *
+ * Here-Dokumente ("cmd << ENDE", Text in den folgenden Zeilen bis "ENDE") und
+ * Here-Strings ("cmd <<< wort"). Der Text liegt in einer anonymen Datei aus
+ * memfd_create, die versiegelt wird; jede Umleitung öffnet sie neu und liest
+ * ab dem Anfang. Keine temporären Dateien, nichts aufzuräumen.
+ *
+ */
+
+#ifndef HEREDOC_H
+#define HEREDOC_H
+
+#include "command.h"
+#include "types.h"
+
+/*
+ * Legt die Umleitung für "<< <word>" (is_string = 0) bzw. "<<< <word>" (1) in der
+ * parse_arena an und merkt sie für heredoc_read_bodies() vor (Parser).
+ */
+Redirection * heredoc_redirection(token_span_t word, int is_string);
+
+/*
+ * Liest die Texte aller vorgemerkten Umleitungen der Zeile, die der Parser gerade
+ * mit '\n' abgeschlossen hat: die Here-Dokumente aus den folgenden Eingabezeilen.
+ */
+void heredoc_read_bodies();
+
+/* Neuer Deskriptor (O_CLOEXEC, Position 0) auf den Text, -1 bei Fehler (Meldung ausgegeben) */
+int heredoc_open(const Redirection *redir);
+
+/* Schließt die memfds der ausgeführten Zeile und vergisst vorgemerkte Umleitungen */
+void heredoc_release();
+
+#endif /* HEREDOC_H */
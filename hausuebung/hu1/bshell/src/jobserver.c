@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include "jobserver.h"
+#include "eventloop.h"
+#include "debug.h"
+
+#define JOBSERVER_TOKEN '+'
+#define JOBSERVER_MIN_FD 10   // weg von den Deskriptoren, die Umleitungen benutzen
+
+/*
+ * Wie bei make hat die Shell einen eigenen Platz (implicit), die übrigen
+ * limit - 1 liegen als Bytes in der Pipe. Die Kinder erben die blockierenden
+ * Enden <pipe_fds>; die Shell liest über einen eigenen, nicht blockierenden
+ * Deskriptor auf dieselbe Pipe (<read_fd>), damit ein anderer Leser sie nie
+ * in einem read() festhalten kann.
+ */
+static int limit = 0;
+static int pipe_fds[2] = { -1, -1 };
+static int read_fd = -1;
+static int implicit_free = 0;
+
+/* Jobs, die gerade einen Platz belegen */
+typedef struct {
+    pid_t pid;
+    int implicit;   // 1 = eigener Platz der Shell, 0 = Token aus der Pipe
+} Holder;
+
+static Holder *holders = NULL;
+static int holder_count = 0;
+static int pending = -1;        // zwischen acquire und attach: implicit (1) oder Token (0)
+
+/* Statistik der Wartezeiten */
+static unsigned long acquired = 0;
+static unsigned long waited = 0;
+static double wait_total_ms = 0;
+static double wait_max_ms = 0;
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void close_pipe() {
+    if (read_fd != -1) close(read_fd);
+    if (pipe_fds[0] != -1) close(pipe_fds[0]);
+    if (pipe_fds[1] != -1) close(pipe_fds[1]);
+    read_fd = pipe_fds[0] = pipe_fds[1] = -1;
+    unsetenv("MAKEFLAGS");
+}
+
+/* Pipe mit limit - 1 Token anlegen und MAKEFLAGS für die Kinder setzen */
+static int open_pipe(int n) {
+    int fds[2];
+    char path[64];
+    char makeflags[64];
+
+    if (pipe(fds) < 0) {
+        perror("jobs");
+        return -1;
+    }
+    pipe_fds[0] = fcntl(fds[0], F_DUPFD, JOBSERVER_MIN_FD);
+    pipe_fds[1] = fcntl(fds[1], F_DUPFD, JOBSERVER_MIN_FD);
+    close(fds[0]);
+    close(fds[1]);
+
+    // eigene offene Datei für die Pipe, O_NONBLOCK gilt dann nur für die Shell
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", pipe_fds[0]);
+    read_fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (pipe_fds[0] < 0 || pipe_fds[1] < 0 || read_fd < 0) {
+        perror("jobs");
+        close_pipe();
+        return -1;
+    }
+
+    for (int i = 0; i < n - 1; i++) {
+        char token = JOBSERVER_TOKEN;
+        if (write(pipe_fds[1], &token, 1) != 1) {
+            perror("jobs");
+            close_pipe();
+            return -1;
+        }
+    }
+
+    // Schreibweise von make >= 4.2 (make 4.4 versteht sie weiterhin)
+    snprintf(makeflags, sizeof(makeflags), " -j%d --jobserver-auth=%d,%d", n, pipe_fds[0], pipe_fds[1]);
+    setenv("MAKEFLAGS", makeflags, 1);
+    return 0;
+}
+
+/*
+ * Laufende Jobs behalten ihren Platz aus der alten Pipe nicht: sie geben nichts
+ * zurück und zählen für das neue Limit nicht mit.
+ */
+int jobserver_set_limit(int n) {
+    if (n < 0) {
+        return -1;
+    }
+    close_pipe();
+    free(holders);
+    holders = NULL;
+    holder_count = 0;
+    pending = -1;
+    limit = 0;
+
+    if (n == 0) {
+        return 0;
+    }
+    holders = malloc(n * sizeof(Holder));
+    if (holders == NULL) {
+        perror("jobs");
+        return -1;
+    }
+    if (open_pipe(n) < 0) {
+        free(holders);
+        holders = NULL;
+        return -1;
+    }
+    limit = n;
+    implicit_free = 1;
+    return 0;
+}
+
+int jobserver_limit() {
+    return limit;
+}
+
+/* Versucht einen Platz ohne zu warten zu bekommen, 1 bei Erfolg */
+static int try_acquire() {
+    char token;
+
+    if (implicit_free) {
+        implicit_free = 0;
+        pending = 1;
+        return 1;
+    }
+    // Andere Leser (z. B. make) schlafen in read() auf ihrem Ende; hier nie
+    if (read(read_fd, &token, 1) == 1) {
+        pending = 0;
+        return 1;
+    }
+    return 0;
+}
+
+void jobserver_acquire() {
+    struct timespec start;
+    struct pollfd fds[2];
+
+    if (limit == 0) {
+        return;
+    }
+    acquired++;
+    if (try_acquire()) {
+        return;
+    }
+
+    // Alle Plätze belegt: auf ein beendetes Kind oder ein Token warten
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    fds[0].fd = eventloop_fd();
+    fds[0].events = POLLIN;
+    fds[1].fd = read_fd;
+    fds[1].events = POLLIN;
+    do {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        eventloop_reap();   // ruft jobserver_release() für beendete Jobs auf
+    } while (!try_acquire());
+
+    double ms = elapsed_ms(&start);
+    waited++;
+    wait_total_ms += ms;
+    if (ms > wait_max_ms)
+        wait_max_ms = ms;
+}
+
+void jobserver_attach(pid_t pid) {
+    if (pending < 0) {
+        return;
+    }
+    holders[holder_count].pid = pid;
+    holders[holder_count].implicit = pending;
+    holder_count++;
+    pending = -1;
+}
+
+/* Platz zurück in die Pipe oder an die Shell */
+static void put_back(int implicit) {
+    char token = JOBSERVER_TOKEN;
+
+    if (implicit) {
+        implicit_free = 1;
+    } else if (write(pipe_fds[1], &token, 1) != 1) {
+        perror("jobs");
+    }
+}
+
+void jobserver_cancel() {
+    if (pending < 0) {
+        return;
+    }
+    put_back(pending);
+    pending = -1;
+}
+
+void jobserver_release(pid_t pid) {
+    // höchstens <limit> Einträge, eine lineare Suche reicht
+    for (int i = 0; i < holder_count; i++) {
+        if (holders[i].pid == pid) {
+            put_back(holders[i].implicit);
+            holders[i] = holders[--holder_count];
+            return;
+        }
+    }
+}
+
+void jobserver_print_stats() {
+    if (limit == 0 && acquired == 0) {
+        return;
+    }
+    printf("(job slots %d, %d busy: %lu started, %lu waited, wait total %.1f ms, max %.1f ms)\n",
+           limit, holder_count, acquired, waited, wait_total_ms, wait_max_ms);
+}
@@ -0,0 +1,38 @@
+/*
+ * jobserver.h
+ *
+ * Begrenzung gleichzeitiger Hintergrundjobs wie bei "make -j" ("jobs -j N").
+ * Die Plätze liegen als Token in einer Pipe, die über MAKEFLAGS an alle Kinder
+ * weitergegeben wird (Jobserver-Protokoll von GNU make). Ein make, das als
+ * Hintergrundjob läuft, teilt sich damit dasselbe Budget mit der Shell.
+ *
+ */
+
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <sys/types.h>
+
+/* Plätze für Hintergrundjobs festlegen, 0 = unbegrenzt. Rückgabe: 0 oder -1 */
+int jobserver_set_limit(int limit);
+
+/* aktuelle Anzahl Plätze (0 = unbegrenzt) */
+int jobserver_limit();
+
+/*
+ * Holt einen Platz für den nächsten Hintergrundjob und wartet, bis einer frei
+ * wird (beendete Kinder werden dabei eingesammelt). Danach jobserver_attach()
+ * mit dem pid des Jobs oder jobserver_cancel(), wenn der Start fehlschlug.
+ * Ohne Begrenzung kehrt die Funktion sofort zurück.
+ */
+void jobserver_acquire();
+void jobserver_attach(pid_t pid);
+void jobserver_cancel();
+
+/* Gibt den Platz von <pid> zurück, falls er einen hatte (aus eventloop_reap()) */
+void jobserver_release(pid_t pid);
+
+/* Wartezeiten auf freie Plätze für "status" */
+void jobserver_print_stats();
+
+#endif /* JOBSERVER_H */
@@ -0,0 +1,511 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "command.h"
+#include "launcher.h"
+#include "pathcache.h"
+#include "heredoc.h"
+#include "shell.h"
+#include "debug.h"
+
+extern char **environ;
+
+/*
+ * Öffnet alle Umleitungen des Befehls im Elternprozess (mit O_CLOEXEC).
+ * Wie bei der alten Variante im Kind gewinnt die letzte Umleitung pro Richtung,
+ * frühere werden trotzdem geöffnet (O_TRUNC/O_CREAT wirken also weiterhin).
+ * Rückgabe: 0 bei Erfolg, -1 bei Fehler (Meldung ausgegeben, fds geschlossen).
+ */
+int redirections_open(SimpleCommand *cmd_s, int *fd_in, int *fd_out) {
+    List *redirige = cmd_s->redirections;
+    *fd_in = -1;
+    *fd_out = -1;
+
+    while (redirige != NULL) {
+        Redirection *redir = (Redirection *)redirige->head;
+        int fd;
+
+        if (redir->r_type == R_FILE) {
+            if (redir->r_mode == M_WRITE)
+                fd = open(redir->u.r_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            else if (redir->r_mode == M_APPEND)
+                fd = open(redir->u.r_file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            else // M_READ
+                fd = open(redir->u.r_file, O_RDONLY | O_CLOEXEC);
+
+            if (fd < 0) {
+                // Die Umleitungen einer Gruppe "( ... ) > datei" hängen an einem Befehl ohne Tokens
+                fprintf(stderr, "%s: %s: %s\n", cmd_s->command_token_counter > 0 ? cmd_s->command_tokens[0] : "-bshell",
+                        redir->u.r_file, strerror(errno));
+                if (*fd_in != -1) close(*fd_in);
+                if (*fd_out != -1) close(*fd_out);
+                return -1;
+            }
+
+            int *target = (redir->r_mode == M_READ) ? fd_in : fd_out;
+            if (*target != -1) close(*target);
+            *target = fd;
+        } else if (redir->r_mode == M_HEREDOC) {
+            // << und <<<: eigener Deskriptor auf das memfd der Zeile
+            fd = heredoc_open(redir);
+            if (fd < 0) {
+                if (*fd_in != -1) close(*fd_in);
+                if (*fd_out != -1) close(*fd_out);
+                return -1;
+            }
+            if (*fd_in != -1) close(*fd_in);
+            *fd_in = fd;
+        }
+
+        redirige = redirige->tail;
+    }
+    return 0;
+}
+
+/*
+ * Prüft vor dem Start, ob argv und Umgebung in ARG_MAX passen, damit ein zu
+ * langer Befehl eine klare Meldung bekommt statt eines E2BIG aus execve.
+ * Die Tokenlängen kennt der Parser schon (command_spans), strlen ist nur für environ nötig.
+ * Linux begrenzt zusätzlich jedes einzelne Argument (MAX_ARG_STRLEN = 32 Seiten).
+ */
+static int argv_fits(SimpleCommand *cmd_s) {
+    static long arg_max = 0;
+    static long page_size = 0;
+    size_t total = sizeof(char *);   // NULL am Ende von argv
+    long max_strlen;
+
+    if (arg_max == 0) {
+        arg_max = sysconf(_SC_ARG_MAX);
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+    max_strlen = 32 * page_size;
+
+    for (int i = 0; i < cmd_s->command_token_counter; i++) {
+        size_t len = cmd_s->command_spans[i].len;
+        if ((long)len >= max_strlen) {
+            fprintf(stderr, "-bshell: %s : argument %d too long (%zu bytes, limit %ld)\n",
+                    cmd_s->command_tokens[0], i, len, max_strlen - 1);
+            return 0;
+        }
+        total += len + 1 + sizeof(char *);
+    }
+    for (char **env = environ; *env != NULL; env++) {
+        total += strlen(*env) + 1 + sizeof(char *);
+    }
+    total += sizeof(char *);
+
+    if (arg_max > 0 && total > (size_t)arg_max) {
+        fprintf(stderr, "-bshell: %s : argument list too long (%zu bytes, limit %ld)\n",
+                cmd_s->command_tokens[0], total, arg_max);
+        return 0;
+    }
+    return 1;
+}
+
+/* ioprio_set(2) hat keinen glibc-Wrapper, die Konstanten kommen aus linux/ioprio.h */
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_RT 1
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+
+/* "0-3,6" -> <cpus>; 0 oder -1 */
+static int parse_cpus(const char *list, cpu_set_t *cpus) {
+    const char *p = list;
+
+    CPU_ZERO(cpus);
+    while (*p != '\0') {
+        char *end;
+        long from = strtol(p, &end, 10), to;
+        if (end == p || from < 0)
+            return -1;
+        to = from;
+        if (*end == '-') {
+            p = end + 1;
+            to = strtol(p, &end, 10);
+            if (end == p || to < from)
+                return -1;
+        }
+        if (to >= CPU_SETSIZE)
+            return -1;
+        for (long cpu = from; cpu <= to; cpu++)
+            CPU_SET(cpu, cpus);
+        if (*end == ',' && end[1] != '\0')
+            end++;
+        else if (*end != '\0')
+            return -1;
+        p = end;
+    }
+    return CPU_COUNT(cpus) > 0 ? 0 : -1;
+}
+
+/* "name" oder "name:N" mit 0 <= N <= <max>; liefert N oder <dflt>, -1 bei Fehler */
+static int parse_level(const char *value, const char *name, int dflt, int max) {
+    size_t len = strlen(name);
+    char *end;
+    long level;
+
+    if (strncmp(value, name, len) != 0)
+        return -1;
+    if (value[len] == '\0')
+        return dflt;
+    if (value[len] != ':')
+        return -1;
+    level = strtol(value + len + 1, &end, 10);
+    if (*end != '\0' || end == value + len + 1 || level < 0 || level > max)
+        return -1;
+    return (int)level;
+}
+
+static int parse_policy(const char *value, RunOptions *run) {
+    static const struct {
+        const char *name;
+        int policy;
+    } policies[] = {
+        { "other", SCHED_OTHER }, { "batch", SCHED_BATCH }, { "idle", SCHED_IDLE },
+    };
+
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcmp(value, policies[i].name) == 0) {
+            run->policy = policies[i].policy;
+            run->priority = 0;
+            return 0;
+        }
+    }
+    // Echtzeit braucht eine Priorität (Vorgabe 1)
+    int prio = parse_level(value, "fifo", 1, 99);
+    if (prio > 0) {
+        run->policy = SCHED_FIFO;
+    } else if ((prio = parse_level(value, "rr", 1, 99)) > 0) {
+        run->policy = SCHED_RR;
+    } else {
+        return -1;
+    }
+    run->priority = prio;
+    return 0;
+}
+
+static int parse_ioprio(const char *value, RunOptions *run) {
+    int level;
+
+    if (strcmp(value, "idle") == 0) {
+        run->ioprio = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    } else if ((level = parse_level(value, "be", 4, 7)) >= 0) {
+        run->ioprio = IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT | level;
+    } else if ((level = parse_level(value, "rt", 4, 7)) >= 0) {
+        run->ioprio = IOPRIO_CLASS_RT << IOPRIO_CLASS_SHIFT | level;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int run_options_parse(char **argv, RunOptions *run) {
+    int i;
+
+    for (i = 1; argv[i] != NULL && strncmp(argv[i], "--", 2) == 0; i++) {
+        const char *opt = argv[i] + 2;
+        const char *value = strchr(opt, '=');
+        int bad;
+
+        if (*opt == '\0')
+            return i + 1;   // "--": danach kommt der Befehl
+        if (value == NULL) {
+            fprintf(stderr, "-bshell: run: %s: expected --option=value\n", argv[i]);
+            return -1;
+        }
+        value++;
+        if (strncmp(opt, "cpus=", 5) == 0) {
+            bad = parse_cpus(value, &run->cpus) < 0;
+            run->set_cpus = 1;
+        } else if (strncmp(opt, "policy=", 7) == 0) {
+            bad = parse_policy(value, run) < 0;
+        } else if (strncmp(opt, "nice=", 5) == 0) {
+            char *end;
+            long nice = strtol(value, &end, 10);
+            bad = *value == '\0' || *end != '\0' || nice < -20 || nice > 19;
+            run->nice = (int)nice;
+            run->set_nice = 1;
+        } else if (strncmp(opt, "ioprio=", 7) == 0) {
+            bad = parse_ioprio(value, run) < 0;
+        } else {
+            fprintf(stderr, "-bshell: run: %s: unknown option\n", argv[i]);
+            return -1;
+        }
+        if (bad) {
+            fprintf(stderr, "-bshell: run: %s: invalid value\n", argv[i]);
+            return -1;
+        }
+    }
+    return i;
+}
+
+/*
+ * Setzt <run> für den aufrufenden Prozess. Läuft im Kind zwischen clone und execve,
+ * also nur Syscalls. Rückgabe: 0 oder -1 mit errno, <what> nennt die Einstellung.
+ */
+static int run_options_apply(const RunOptions *run, const char **what) {
+    if (run->set_cpus && sched_setaffinity(0, sizeof(cpu_set_t), &run->cpus) < 0) {
+        *what = "cpus";
+        return -1;
+    }
+    if (run->policy >= 0) {
+        struct sched_param param = { .sched_priority = run->priority };
+        if (sched_setscheduler(0, run->policy, &param) < 0) {
+            *what = "policy";
+            return -1;
+        }
+    }
+    if (run->set_nice && setpriority(PRIO_PROCESS, 0, run->nice) < 0) {
+        *what = "nice";
+        return -1;
+    }
+    if (run->ioprio >= 0 && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, run->ioprio) < 0) {
+        *what = "ioprio";
+        return -1;
+    }
+    return 0;
+}
+
+/* Daten für das Kind von spawn_clone (liegen im gemeinsamen Speicher) */
+typedef struct {
+    const char *path;
+    char **argv;
+    int dup_from[4];        // der Reihe nach auf dup_to[] legen, -1 = nichts
+    int dup_to[4];
+    const int *keep_fds;    // ohne FD_CLOEXEC vererben
+    int keep_count;
+    pid_t pgid;
+    int setpgroup;
+    const RunOptions *run;
+    int err;                // errno, falls das Kind nicht bis zum exec kommt
+    const char *what;       // was dabei scheiterte (NULL = execve)
+} CloneArgs;
+
+#define CLONE_STACK_SIZE (64 * 1024)
+
+static int clone_child(void *arg) {
+    CloneArgs *args = arg;
+    struct sigaction action;
+    sigset_t empty;
+
+    // Wie posix_spawn: Handler der Shell dürfen im Kind nicht laufen (gemeinsamer
+    // Speicher), SIGINT/SIGTTOU bekommen die Standardbehandlung zurück
+    for (int sig = 1; sig < NSIG; sig++) {
+        if (sigaction(sig, NULL, &action) < 0)
+            continue;
+        if (sig == SIGINT || sig == SIGTTOU || (action.sa_handler != SIG_IGN && action.sa_handler != SIG_DFL)) {
+            memset(&action, 0, sizeof(action));
+            action.sa_handler = SIG_DFL;
+            sigaction(sig, &action, NULL);
+        }
+    }
+    if (args->setpgroup && setpgid(0, args->pgid) < 0) {
+        args->what = "setpgid";
+        goto fail;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (args->dup_from[i] != -1 && dup2(args->dup_from[i], args->dup_to[i]) < 0) {
+            args->what = "dup2";
+            goto fail;
+        }
+    }
+    for (int i = 0; i < args->keep_count; i++) {
+        if (fcntl(args->keep_fds[i], F_SETFD, 0) < 0) {
+            args->what = "fcntl";
+            goto fail;
+        }
+    }
+    if (run_options_apply(args->run, &args->what) < 0)
+        goto fail;
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, NULL);
+
+    execve(args->path, args->argv, environ);
+fail:
+    args->err = errno;
+    _exit(127);
+}
+
+/*
+ * Start über clone(CLONE_VM|CLONE_VFORK) wie in posix_spawn, aber mit den run-Optionen
+ * im Kind. Rückgabe: pid oder -1; <err>/<what> beschreiben den Fehler.
+ */
+static pid_t spawn_clone(CloneArgs *args) {
+    sigset_t all, old;
+    char *stack = malloc(CLONE_STACK_SIZE);
+    pid_t pid;
+
+    if (stack == NULL) {
+        args->err = ENOMEM;
+        return -1;
+    }
+    // Kein Signal darf im Kind ankommen, bevor es seine Handler zurückgesetzt hat
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    pid = clone(clone_child, stack + CLONE_STACK_SIZE, CLONE_VM | CLONE_VFORK | SIGCHLD, args);
+    if (pid < 0)
+        args->err = errno;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    free(stack);   // CLONE_VFORK: das Kind hat exec aufgerufen oder ist beendet
+
+    if (pid > 0 && args->err != 0) {
+        // Gescheitertes Kind selbst einsammeln, sonst meldet die eventloop einen Job
+        waitpid(pid, NULL, 0);
+        pid = -1;
+    }
+    return pid;
+}
+
+int spawn_prepare(SimpleCommand *cmd_s, SpawnOptions *opts) {
+    char **command = cmd_s->command_tokens;
+
+    // Unbekannte Befehle schon hier im Elternprozess abweisen, ohne einen Prozess zu starten
+    opts->path = pathcache_lookup(command[0]);
+    if (opts->path == NULL) {
+        fprintf(stderr, "-bshell: %s : command not found\n", command[0]);
+        return -127;
+    }
+    if (!argv_fits(cmd_s)) {
+        opts->path = NULL;
+        return -126;
+    }
+    return 0;
+}
+
+pid_t spawn_simple_command(SimpleCommand *cmd_s, const SpawnOptions *opts) {
+    char **command = cmd_s->command_tokens;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigdefault, sigmask;
+    int redir_in, redir_out;
+    const char *path = opts->path;
+    pid_t pid = -1;
+    int err;
+
+    if (path == NULL) {
+        SpawnOptions prepared = *opts;
+        if ((err = spawn_prepare(cmd_s, &prepared)) < 0) {
+            return err;
+        }
+        path = prepared.path;
+    }
+
+    if (redirections_open(cmd_s, &redir_in, &redir_out) < 0) {
+        return -1;
+    }
+
+    if (opts->run != NULL) {
+        CloneArgs args = {
+            .path = path, .argv = command,
+            .dup_from = { opts->fd_in, opts->fd_out, redir_in, redir_out },
+            .dup_to = { STDIN_FILENO, STDOUT_FILENO, STDIN_FILENO, STDOUT_FILENO },
+            .keep_fds = opts->keep_fds, .keep_count = opts->keep_count,
+            .pgid = opts->pgid, .setpgroup = shell_interactive, .run = opts->run,
+        };
+        pid = spawn_clone(&args);
+        if (redir_in != -1) close(redir_in);
+        if (redir_out != -1) close(redir_out);
+        if (pid < 0) {
+            if (args.what != NULL)
+                fprintf(stderr, "-bshell: %s : %s: %s\n", command[0], args.what, strerror(args.err));
+            else if (args.err == ENOENT)
+                fprintf(stderr, "-bshell: %s : command not found\n", command[0]);
+            else
+                fprintf(stderr, "-bshell: %s : %s\n", command[0], strerror(args.err));
+            return args.what == NULL && args.err == ENOENT ? -127 : -126;
+        }
+        return pid;
+    }
+
+    // === UMLEITUNGEN als File-Actions ===
+    // Reihenfolge wie früher im Kind: zuerst die Pipe, danach die Dateien
+    posix_spawn_file_actions_init(&actions);
+    if (opts->fd_in != -1)
+        posix_spawn_file_actions_adddup2(&actions, opts->fd_in, STDIN_FILENO);
+    if (opts->fd_out != -1)
+        posix_spawn_file_actions_adddup2(&actions, opts->fd_out, STDOUT_FILENO);
+    if (redir_in != -1)
+        posix_spawn_file_actions_adddup2(&actions, redir_in, STDIN_FILENO);
+    if (redir_out != -1)
+        posix_spawn_file_actions_adddup2(&actions, redir_out, STDOUT_FILENO);
+    // dup2 auf sich selbst löscht FD_CLOEXEC (glibc >= 2.29)
+    for (int i = 0; i < opts->keep_count; i++)
+        posix_spawn_file_actions_adddup2(&actions, opts->keep_fds[i], opts->keep_fds[i]);
+
+    // === ATTRIBUTE: Prozessgruppe und Signale ===
+    // Die Shell ignoriert SIGINT/SIGTTOU, das Kind bekommt die Standardbehandlung zurück
+    posix_spawnattr_init(&attr);
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGINT);
+    sigaddset(&sigdefault, SIGTTOU);
+    sigemptyset(&sigmask);
+    posix_spawnattr_setsigdefault(&attr, &sigdefault);
+    posix_spawnattr_setsigmask(&attr, &sigmask);
+    posix_spawnattr_setpgroup(&attr, opts->pgid);
+    // Ohne Jobkontrolle (-c / Skript) bleiben die Kinder in der Prozessgruppe der Shell
+    posix_spawnattr_setflags(&attr, (shell_interactive ? POSIX_SPAWN_SETPGROUP : 0) | POSIX_SPAWN_SETSIGDEF
+                                    | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_USEVFORK);
+
+    err = posix_spawn(&pid, path, &actions, &attr, command, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (redir_in != -1) close(redir_in);
+    if (redir_out != -1) close(redir_out);
+
+    if (err != 0) {
+        if (err == ENOENT)
+            fprintf(stderr, "-bshell: %s : command not found\n", command[0]);
+        else
+            fprintf(stderr, "-bshell: %s : %s\n", command[0], strerror(err));
+        return err == ENOENT ? -127 : -126;
+    }
+
+    debug_print("[%s] spawned %s as %d (pgid %d)\n", __func__, command[0], pid, opts->pgid);
+    return pid;
+}
+
+int exec_simple_command(SimpleCommand *cmd_s) {
+    char **command = cmd_s->command_tokens;
+    const char *path;
+    int redir_in, redir_out;
+    sigset_t empty;
+
+    path = pathcache_lookup(command[0]);
+    if (path == NULL) {
+        fprintf(stderr, "-bshell: %s : command not found\n", command[0]);
+        return 127;
+    }
+    if (!argv_fits(cmd_s)) {
+        return 126;
+    }
+    if (redirections_open(cmd_s, &redir_in, &redir_out) < 0) {
+        return 1;
+    }
+
+    // Gleicher Zustand wie bei einem gestarteten Kind
+    fflush(stdout);
+    fflush(stderr);
+    if (redir_in != -1) dup2(redir_in, STDIN_FILENO);
+    if (redir_out != -1) dup2(redir_out, STDOUT_FILENO);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, NULL);
+
+    execve(path, command, environ);
+    fprintf(stderr, "-bshell: %s : %s\n", command[0], strerror(errno));
+    return 126;
+}
@@ -0,0 +1,85 @@
+/*
+ * launcher.h
+ *
+ * Gemeinsame Startschicht für externe Befehle (execute_fork und C_PIPE).
+ * Statt fork()+exec wird posix_spawn verwendet, das unter glibc intern
+ * clone(CLONE_VM|CLONE_VFORK) nutzt und damit keine Seitentabellen kopiert.
+ * Mit run-Optionen ruft der Launcher clone selbst auf, weil posix_spawn
+ * Affinität, nice und I/O-Priorität nicht setzen kann.
+ *
+ */
+
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include <sched.h>
+#include <sys/types.h>
+#include "command.h"
+
+/*
+ * Scheduling des Kindes ("run --cpus=0-3 --policy=batch --nice=10 --ioprio=idle cmd").
+ * Wird im Kind vor dem exec gesetzt, ersetzt also taskset/chrt/nice/ionice.
+ */
+typedef struct {
+    int set_cpus;
+    cpu_set_t cpus;   /* sched_setaffinity */
+    int policy;       /* SCHED_*, -1 = unverändert */
+    int priority;     /* sched_priority für SCHED_FIFO/SCHED_RR */
+    int set_nice;
+    int nice;         /* setpriority */
+    int ioprio;       /* ioprio_set (Klasse << 13 | Stufe), -1 = unverändert */
+} RunOptions;
+
+/*
+ * Liest die Optionen ab argv[1] ("--cpus=LISTE", "--policy=other|batch|idle|fifo[:P]|rr[:P]",
+ * "--nice=N", "--ioprio=idle|be[:N]|rt[:N]", "--" beendet) nach <run>.
+ * Rückgabe: Anzahl verbrauchter Wörter einschließlich argv[0], -1 bei Fehler (Meldung ausgegeben).
+ */
+int run_options_parse(char **argv, RunOptions *run);
+
+/*
+ * Wie der Kindprozess eingebettet wird.
+ */
+typedef struct {
+    int fd_in;    /* wird zu STDIN (-1 = unverändert), z. B. Leseseite einer Pipe */
+    int fd_out;   /* wird zu STDOUT (-1 = unverändert), z. B. Schreibseite einer Pipe */
+    pid_t pgid;   /* Prozessgruppe, 0 = eigene Gruppe mit pid als pgid */
+    const char *path; /* aufgelöster Pfad (spawn_prepare), NULL = wird beim Start gesucht */
+    const RunOptions *run; /* Scheduling für das Kind, NULL = wie die Shell */
+    const int *keep_fds;   /* bleiben trotz O_CLOEXEC offen (/dev/fd/N der Prozess-Substitutionen) */
+    int keep_count;
+} SpawnOptions;
+
+/*
+ * Öffnet die Umleitungsdateien des Befehls (O_CLOEXEC). Pro Richtung gewinnt die
+ * letzte Umleitung, nicht vorhandene Richtungen liefern -1.
+ * Rückgabe: 0 oder -1 (Fehlermeldung ausgegeben, nichts bleibt offen).
+ */
+int redirections_open(SimpleCommand *cmd_s, int *fd_in, int *fd_out);
+
+/*
+ * Sucht den Pfad des Befehls (pathcache) und prüft argv gegen ARG_MAX; trägt
+ * den Pfad in <opts> ein. Nur im Hauptthread aufrufen, der pathcache ist nicht
+ * threadsicher. Rückgabe: 0 oder der negative Status wie in sh (Fehlermeldung
+ * ausgegeben): -127 nicht gefunden, -126 argv zu lang.
+ */
+int spawn_prepare(SimpleCommand *cmd_s, SpawnOptions *opts);
+
+/*
+ * Startet den einfachen Befehl mit seinen Umleitungen.
+ * Ist opts->path schon gesetzt (spawn_prepare), darf das auch in einem anderen
+ * Thread passieren (parallele Pipe-Stufen).
+ * Rückgabe: pid des Kindes oder der negative Status (Fehlermeldung wurde bereits
+ * ausgegeben): -127 nicht gefunden, -126 nicht ausführbar, -1 Umleitung gescheitert.
+ */
+pid_t spawn_simple_command(SimpleCommand *cmd_s, const SpawnOptions *opts);
+
+/*
+ * Ersetzt die Shell per execve durch den Befehl (Umleitungen werden im eigenen Prozess
+ * gesetzt). Ohne run-Präfix: nice, Affinität und Limits gälten sonst auch für die Shell,
+ * falls das exec scheitert; mit run startet execute() ein Kind (spawn_clone()).
+ * Kehrt nur zurück, wenn das nicht möglich war, und liefert dann den Exit-Status.
+ */
+int exec_simple_command(SimpleCommand *cmd_s);
+
+#endif /* LAUNCHER_H */
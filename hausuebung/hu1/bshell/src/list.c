@@ -16,3 +16,10 @@ List * list_append(void * element, List * tail){
     return lst;
 }
 
+
+List * list_append_arena(Arena * arena, void * element, List * tail){
+    List * lst = arena_alloc(arena, sizeof(List));
+    lst->head=element;
+    lst->tail=tail;
+    return lst;
+}
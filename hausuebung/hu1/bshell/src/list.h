@@ -9,6 +9,8 @@
 
 #define LIST_H
 
+#include "arena.h"
+
 typedef struct list {
     void *head; //Enthlt einen Zeiger auf ein Element (eines beliebigen Typs)
     struct list *tail;
@@ -16,4 +18,7 @@ typedef struct list {
 
 List * list_append(void * head, List * tail);
 
+/* same as list_append, but the list node lives in <arena> */
+List * list_append_arena(Arena * arena, void * head, List * tail);
+
 #endif /* end of include guard: LIST_H */
@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "pathcache.h"
+#include "debug.h"
+
+#define PATHCACHE_DEFAULT_PATH "/bin:/usr/bin"
+#define PATHCACHE_INITIAL_BUCKETS 64
+
+typedef struct PathEntry {
+    char *name;             // Befehlsname, z. B. "ls"
+    char *path;             // aufgelöster Pfad, z. B. "/usr/bin/ls"
+    int dir_index;          // Index des Treffer-Verzeichnisses in PATH
+    unsigned int hits;      // Anzahl der Starts über diesen Eintrag
+    struct PathEntry *next; // nächster Eintrag im selben Bucket
+} PathEntry;
+
+/* Ein Verzeichnis aus $PATH mit der mtime beim Aufbau der Tabelle */
+typedef struct {
+    char *dir;
+    int exists;
+    struct timespec mtime;
+} PathDir;
+
+static PathEntry **buckets = NULL;
+static size_t bucket_count = 0;
+static size_t entry_count = 0;
+
+static unsigned long generation = 0;  // zählt das Leeren der Tabelle, siehe pathcache_generation()
+
+// Einträge geleerter Tabellen: ihre Pfade können noch in vorbereiteten Stufen
+// einer Pipe stecken, freigegeben erst mit pathcache_release() vor der nächsten Zeile
+static PathEntry *retired = NULL;
+
+static char *cached_path_env = NULL;  // $PATH, zu dem die Tabelle gehört
+static PathDir *dirs = NULL;
+static int dir_count = 0;
+
+/* FNV-1a */
+static size_t hash_name(const char *name) {
+    size_t h = 2166136261u;
+    while (*name) {
+        h ^= (unsigned char)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void stat_dir(PathDir *d) {
+    struct stat st;
+    if (stat(d->dir, &st) == 0) {
+        d->exists = 1;
+        d->mtime = st.st_mtim;
+    } else {
+        d->exists = 0;
+        d->mtime.tv_sec = 0;
+        d->mtime.tv_nsec = 0;
+    }
+}
+
+static int dir_changed(PathDir *d) {
+    PathDir now = *d;
+    stat_dir(&now);
+    return now.exists != d->exists
+        || now.mtime.tv_sec != d->mtime.tv_sec
+        || now.mtime.tv_nsec != d->mtime.tv_nsec;
+}
+
+static void free_entries() {
+    for (size_t i = 0; i < bucket_count; i++) {
+        PathEntry *e = buckets[i];
+        while (e != NULL) {
+            PathEntry *next = e->next;
+            e->next = retired;
+            retired = e;
+            e = next;
+        }
+        buckets[i] = NULL;
+    }
+    entry_count = 0;
+    generation++;
+}
+
+/* Zerlegt $PATH in Verzeichnisse und merkt sich deren mtime */
+static void load_path(const char *path_env) {
+    for (int i = 0; i < dir_count; i++) {
+        free(dirs[i].dir);
+    }
+    free(dirs);
+    free(cached_path_env);
+
+    cached_path_env = strdup(path_env);
+    dir_count = 1;
+    for (const char *p = path_env; *p; p++) {
+        if (*p == ':') dir_count++;
+    }
+    dirs = calloc(dir_count, sizeof(PathDir));
+
+    const char *start = path_env;
+    for (int i = 0; i < dir_count; i++) {
+        const char *end = strchrnul(start, ':');
+        // leerer Eintrag bedeutet wie bei execvp das aktuelle Verzeichnis
+        dirs[i].dir = (end == start) ? strdup(".") : strndup(start, end - start);
+        stat_dir(&dirs[i]);
+        start = end + 1;
+    }
+}
+
+void pathcache_clear() {
+    free_entries();
+    for (int i = 0; i < dir_count; i++) {
+        stat_dir(&dirs[i]);
+    }
+}
+
+/*
+ * Prüft, ob die Tabelle noch zu $PATH passt. Für einen Treffer im Verzeichnis
+ * <upto> genügen die Verzeichnisse davor und das Trefferverzeichnis selbst:
+ * nur dort kann ein neues Programm den Eintrag verdecken oder der Eintrag verschwinden.
+ */
+static int cache_valid(int upto) {
+    for (int i = 0; i <= upto && i < dir_count; i++) {
+        if (dir_changed(&dirs[i])) {
+            debug_print("[%s] %s changed, flushing\n", __func__, dirs[i].dir);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void sync_path_env() {
+    const char *path_env = getenv("PATH");
+    if (path_env == NULL) {
+        path_env = PATHCACHE_DEFAULT_PATH;
+    }
+    if (cached_path_env == NULL || strcmp(cached_path_env, path_env) != 0) {
+        free_entries();
+        load_path(path_env);
+    }
+}
+
+static void grow_buckets() {
+    size_t new_count = bucket_count == 0 ? PATHCACHE_INITIAL_BUCKETS : bucket_count * 2;
+    PathEntry **new_buckets = calloc(new_count, sizeof(PathEntry *));
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        PathEntry *e = buckets[i];
+        while (e != NULL) {
+            PathEntry *next = e->next;
+            size_t b = hash_name(e->name) & (new_count - 1);
+            e->next = new_buckets[b];
+            new_buckets[b] = e;
+            e = next;
+        }
+    }
+    free(buckets);
+    buckets = new_buckets;
+    bucket_count = new_count;
+}
+
+/* Durchsucht die Verzeichnisse wie execvp, aber ohne exec-Versuche */
+static PathEntry * search_path(const char *name) {
+    size_t name_len = strlen(name);
+
+    for (int i = 0; i < dir_count; i++) {
+        size_t dir_len = strlen(dirs[i].dir);
+        char *candidate;
+        struct stat st;
+
+        if (!dirs[i].exists) continue;
+
+        candidate = malloc(dir_len + name_len + 2);
+        memcpy(candidate, dirs[i].dir, dir_len);
+        candidate[dir_len] = '/';
+        memcpy(candidate + dir_len + 1, name, name_len + 1);
+
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            PathEntry *e = malloc(sizeof(PathEntry));
+            e->name = strdup(name);
+            e->path = candidate;
+            e->dir_index = i;
+            e->hits = 0;
+            return e;
+        }
+        free(candidate);
+    }
+    return NULL;
+}
+
+const char * pathcache_lookup(const char *name) {
+    if (strchr(name, '/') != NULL) {
+        return name;
+    }
+
+    sync_path_env();
+    if (bucket_count == 0) {
+        grow_buckets();
+    }
+
+    size_t b = hash_name(name) & (bucket_count - 1);
+    for (PathEntry *e = buckets[b]; e != NULL; e = e->next) {
+        if (strcmp(e->name, name) == 0) {
+            if (cache_valid(e->dir_index)) {
+                e->hits++;
+                return e->path;
+            }
+            pathcache_clear();
+            break;
+        }
+    }
+
+    // Nicht gefunden werden nicht gespeichert: die Suche liefe beim nächsten Mal ohnehin über alle Verzeichnisse
+    PathEntry *e = search_path(name);
+    if (e == NULL) {
+        return NULL;
+    }
+
+    if (entry_count + 1 > bucket_count * 3 / 4) {
+        grow_buckets();
+    }
+    b = hash_name(name) & (bucket_count - 1);
+    e->next = buckets[b];
+    buckets[b] = e;
+    entry_count++;
+    e->hits++;
+    return e->path;
+}
+
+void pathcache_release() {
+    while (retired != NULL) {
+        PathEntry *next = retired->next;
+        free(retired->name);
+        free(retired->path);
+        free(retired);
+        retired = next;
+    }
+}
+
+unsigned long pathcache_generation() {
+    return generation;
+}
+
+void pathcache_print() {
+    if (entry_count == 0) {
+        printf("hash: hash table empty\n");
+        return;
+    }
+    printf("%-5s %s\n", "hits", "command");
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (PathEntry *e = buckets[i]; e != NULL; e = e->next) {
+            printf("%4u  %s\n", e->hits, e->path);
+        }
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * pathcache.h
+ *
+ * Hash-Tabelle der bereits aufgelösten Programme (wie "hash" in der bash).
+ * Der Elternprozess sucht einmal in $PATH, danach wird direkt der absolute Pfad
+ * gestartet. Die Tabelle wird verworfen, wenn sich $PATH oder die mtime eines
+ * der beteiligten Verzeichnisse ändert.
+ *
+ */
+
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+/*
+ * Liefert den absoluten Pfad für <name> oder NULL, wenn das Programm in $PATH
+ * nicht existiert. Namen mit '/' werden unverändert zurückgegeben.
+ * Der Rückgabewert gehört dem Cache. Er bleibt auch über weitere Aufrufe und
+ * ein Leeren der Tabelle hinweg gültig, bis pathcache_release() ihn vor der
+ * nächsten Zeile freigibt: die Pfade aller Stufen einer Pipe werden vor dem
+ * ersten Start aufgelöst. Über eine Zeile hinaus darf ihn niemand behalten.
+ */
+const char * pathcache_lookup(const char *name);
+
+/*
+ * Ändert sich bei jedem Leeren der Tabelle. Ein gemerkter Rückgabewert von
+ * pathcache_lookup() ist aktuell, solange die Generation gleich bleibt
+ * (lesbar bleibt er bis pathcache_release()).
+ */
+unsigned long pathcache_generation();
+
+/* Leert die Tabelle (hash -r) */
+void pathcache_clear();
+
+/* Gibt die Einträge geleerter Tabellen frei; nur zwischen zwei Zeilen aufrufen */
+void pathcache_release();
+
+/* Gibt alle Einträge mit ihren Trefferzahlen aus (hash ohne Argumente) */
+void pathcache_print();
+
+#endif /* PATHCACHE_H */
@@ -0,0 +1,267 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include "profile.h"
+#include "statuslist.h"
+#include "debug.h"
+
+#define RELAY_CHUNK (1 << 20)   // höchstens so viel pro splice
+
+/* Verbindung von Stufe <index> nach <index> + 1 */
+typedef struct {
+    Profile *profile;
+    int index;
+    int fd_in;              // Leseseite der Pipe aus Stufe <index>
+    int fd_out;             // Schreibseite der Pipe zu Stufe <index> + 1
+    long long bytes;
+    double wait_input;      // Relay wartet auf Daten: Stufe <index> schreibt zu langsam
+    double wait_output;     // Relay wartet auf Platz: Stufe <index> + 1 liest zu langsam
+    int started;
+    pthread_t thread;
+} Relay;
+
+typedef struct {
+    const char *command;
+    pid_t pid;
+} StageInfo;
+
+struct Profile {
+    int stages;
+    Relay *relays;          // stages - 1 Stück
+    StageInfo *info;
+    double interval;
+    struct timespec start;
+    pthread_mutex_t lock;   // schützt bytes/wait_* und done
+    pthread_cond_t wakeup;  // weckt den Melde-Thread zum Schluss
+    int done;
+    int reporter_started;
+    pthread_t reporter;
+};
+
+static double elapsed_s(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+/* Wartet mit poll auf <fd> und addiert die Wartezeit zu <sum> */
+static void relay_wait(Profile *profile, int fd, short events, double *sum) {
+    struct pollfd pfd = { .fd = fd, .events = events };
+    struct timespec before, after;
+
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    while (poll(&pfd, 1, -1) < 0 && errno == EINTR)
+        ;
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    pthread_mutex_lock(&profile->lock);
+    *sum += elapsed_s(&before, &after);
+    pthread_mutex_unlock(&profile->lock);
+}
+
+static void *relay_run(void *arg) {
+    Relay *relay = arg;
+    Profile *profile = relay->profile;
+    struct pollfd pfd = { .fd = relay->fd_in, .events = POLLIN };
+    sigset_t set;
+
+    // Liest Stufe <index> + 1 nicht mehr, soll splice mit EPIPE scheitern
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    for (;;) {
+        ssize_t n = splice(relay->fd_in, NULL, relay->fd_out, NULL, RELAY_CHUNK,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            pthread_mutex_lock(&profile->lock);
+            relay->bytes += n;
+            pthread_mutex_unlock(&profile->lock);
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR))
+            break;   // EOF, oder der Leser ist weg (EPIPE)
+        // EAGAIN: entweder ist die Eingabe leer oder die Ausgabe voll
+        if (poll(&pfd, 1, 0) == 0)
+            relay_wait(profile, relay->fd_in, POLLIN, &relay->wait_input);
+        else
+            relay_wait(profile, relay->fd_out, POLLOUT, &relay->wait_output);
+    }
+    // Schreiber bekommt EPIPE, Leser EOF
+    close(relay->fd_in);
+    close(relay->fd_out);
+    return NULL;
+}
+
+/* profile -i: alle <interval> Sekunden eine Zeile mit den Raten seit der letzten */
+static void *reporter_run(void *arg) {
+    Profile *profile = arg;
+    int connections = profile->stages - 1;
+    long long *last = calloc(connections, sizeof(long long));
+    struct timespec tick = profile->start;
+    long step_ns = (long)(profile->interval * 1e9);
+
+    if (last == NULL)
+        return NULL;
+    pthread_mutex_lock(&profile->lock);
+    while (!profile->done) {
+        tick.tv_sec += step_ns / 1000000000L;
+        tick.tv_nsec += step_ns % 1000000000L;
+        if (tick.tv_nsec >= 1000000000L) {
+            tick.tv_sec++;
+            tick.tv_nsec -= 1000000000L;
+        }
+        // <wakeup> läuft auf CLOCK_MONOTONIC (profile_start), wie <tick>
+        while (!profile->done && pthread_cond_timedwait(&profile->wakeup, &profile->lock, &tick) != ETIMEDOUT)
+            ;
+        if (profile->done)
+            break;
+
+        fprintf(stderr, "profile: %6.1f s", elapsed_s(&profile->start, &tick));
+        for (int i = 0; i < connections; i++) {
+            double rate = (profile->relays[i].bytes - last[i]) / profile->interval / 1e6;
+            last[i] = profile->relays[i].bytes;
+            fprintf(stderr, " | %d->%d %8.1f MB/s", i + 1, i + 2, rate);
+        }
+        fputc('\n', stderr);
+    }
+    pthread_mutex_unlock(&profile->lock);
+    free(last);
+    return NULL;
+}
+
+Profile * profile_start(int stages, double interval) {
+    Profile *profile = calloc(1, sizeof(Profile));
+    pthread_condattr_t attr;
+
+    if (profile == NULL)
+        return NULL;
+    profile->relays = calloc(stages, sizeof(Relay));
+    profile->info = calloc(stages, sizeof(StageInfo));
+    if (profile->relays == NULL || profile->info == NULL) {
+        free(profile->relays);
+        free(profile->info);
+        free(profile);
+        return NULL;
+    }
+    profile->stages = stages;
+    profile->interval = interval;
+    for (int i = 0; i < stages; i++)
+        profile->info[i].pid = -1;
+    pthread_mutex_init(&profile->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&profile->wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &profile->start);
+
+    if (interval > 0 && stages > 1)
+        profile->reporter_started = pthread_create(&profile->reporter, NULL, reporter_run, profile) == 0;
+    return profile;
+}
+
+int profile_relay(Profile *profile, int index, int fd_in, long pipe_size) {
+    Relay *relay = &profile->relays[index];
+    int fd_pipe[2];
+
+    if (pipe2(fd_pipe, O_CLOEXEC) < 0)
+        return fd_in;
+    if (pipe_size > 0)
+        fcntl(fd_pipe[1], F_SETPIPE_SZ, (int)pipe_size);
+    // Nur die Enden des Relays sind nicht blockierend, die der Stufen bleiben normal
+    fcntl(fd_in, F_SETFL, fcntl(fd_in, F_GETFL) | O_NONBLOCK);
+    fcntl(fd_pipe[1], F_SETFL, fcntl(fd_pipe[1], F_GETFL) | O_NONBLOCK);
+
+    relay->profile = profile;
+    relay->index = index;
+    relay->fd_in = fd_in;
+    relay->fd_out = fd_pipe[1];
+    if (pthread_create(&relay->thread, NULL, relay_run, relay) != 0) {
+        close(fd_pipe[0]);
+        close(fd_pipe[1]);
+        fcntl(fd_in, F_SETFL, fcntl(fd_in, F_GETFL) & ~O_NONBLOCK);
+        return fd_in;
+    }
+    relay->started = 1;
+    return fd_pipe[0];
+}
+
+void profile_stage(Profile *profile, int index, const char *command, pid_t pid) {
+    profile->info[index].command = command;
+    profile->info[index].pid = pid;
+}
+
+static void print_ms(double seconds, int available) {
+    if (available)
+        fprintf(stderr, " %11.1f", seconds * 1000.0);
+    else
+        fprintf(stderr, " %11s", "-");
+}
+
+void profile_finish(Profile *profile) {
+    struct timespec end;
+    int connections = profile->stages - 1;
+    int bottleneck = -1;
+    double worst = 0;
+
+    for (int i = 0; i < connections; i++) {
+        if (profile->relays[i].started)
+            pthread_join(profile->relays[i].thread, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_mutex_lock(&profile->lock);
+    profile->done = 1;
+    pthread_cond_signal(&profile->wakeup);
+    pthread_mutex_unlock(&profile->lock);
+    if (profile->reporter_started)
+        pthread_join(profile->reporter, NULL);
+
+    double wall = elapsed_s(&profile->start, &end);
+    fprintf(stderr, "profile: %d stages, %.3f s\n", profile->stages, wall);
+    fprintf(stderr, "%5s  %-16s %10s %10s %11s %11s %11s\n",
+            "stage", "command", "out_MB", "MB/s", "blocked_ms", "starved_ms", "cpu_ms");
+    for (int i = 0; i < profile->stages; i++) {
+        // Ausgang i führt über Relay i, Eingang über Relay i - 1
+        const Relay *out = i < connections && profile->relays[i].started ? &profile->relays[i] : NULL;
+        const Relay *in = i > 0 && profile->relays[i - 1].started ? &profile->relays[i - 1] : NULL;
+        const ProcessInfo *proc = profile->info[i].pid > 0 ? statuslist_find(profile->info[i].pid) : NULL;
+
+        fprintf(stderr, "%5d  %-16.16s", i + 1, profile->info[i].command != NULL ? profile->info[i].command : "?");
+        if (out != NULL)
+            fprintf(stderr, " %10.1f %10.1f", out->bytes / 1e6, wall > 0 ? out->bytes / 1e6 / wall : 0.0);
+        else
+            fprintf(stderr, " %10s %10s", "-", "-");
+        print_ms(out != NULL ? out->wait_output : 0, out != NULL);
+        print_ms(in != NULL ? in->wait_input : 0, in != NULL);
+        if (proc != NULL) {
+            double cpu = proc->usage.ru_utime.tv_sec + proc->usage.ru_utime.tv_usec / 1e6
+                       + proc->usage.ru_stime.tv_sec + proc->usage.ru_stime.tv_usec / 1e6;
+            print_ms(cpu, 1);
+        } else {
+            print_ms(0, 0);
+        }
+        fputc('\n', stderr);
+
+        // Wie lange haben die Nachbarn auf diese Stufe gewartet?
+        double caused = (in != NULL ? in->wait_output : 0) + (out != NULL ? out->wait_input : 0);
+        if (caused > worst) {
+            worst = caused;
+            bottleneck = i;
+        }
+    }
+    if (bottleneck >= 0) {
+        fprintf(stderr, "bottleneck: stage %d (%s), neighbours waited %.1f ms on it\n",
+                bottleneck + 1, profile->info[bottleneck].command, worst * 1000.0);
+    }
+
+    pthread_mutex_destroy(&profile->lock);
+    pthread_cond_destroy(&profile->wakeup);
+    free(profile->relays);
+    free(profile->info);
+    free(profile);
+}
@@ -0,0 +1,37 @@
+/*
+ * profile.h
+ *
+ * "profile a | b | c": zwischen je zwei Stufen hängt die Shell ein Relay
+ * (Thread mit splice), das die übertragenen Bytes zählt und misst, wie lange
+ * es auf Daten bzw. auf Platz gewartet hat. Daraus ergibt sich, welche Stufe
+ * die anderen aufhält. Nach dem Ende der Pipe kommt ein Bericht auf stderr,
+ * mit "-i SEK" zusätzlich laufend eine Zeile mit den aktuellen Raten.
+ *
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <sys/types.h>
+
+#define PROFILE_MAX_STAGES 64   // ein Thread pro Verbindung
+
+typedef struct Profile Profile;
+
+/* Legt das Profil einer Pipe mit <stages> Stufen an; <interval> > 0: laufende Ausgabe (Sekunden) */
+Profile * profile_start(int stages, double interval);
+
+/*
+ * Hängt ein Relay hinter <fd_in> (Leseseite der Pipe aus Stufe <index>) und liefert
+ * die Leseseite für Stufe <index> + 1. Die neue Pipe bekommt <pipe_size> Bytes (0 =
+ * Vorgabe). Geht das nicht, kommt <fd_in> unverändert zurück (Stufen direkt verbunden).
+ */
+int profile_relay(Profile *profile, int index, int fd_in, long pipe_size);
+
+/* Name und pid der Stufe <index> für den Bericht (pid -1: Builtin oder nicht gestartet) */
+void profile_stage(Profile *profile, int index, const char *command, pid_t pid);
+
+/* Wartet auf die Relays, gibt den Bericht aus und gibt das Profil frei */
+void profile_finish(Profile *profile);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "program.h"
+#include "arena.h"
+#include "debug.h"
+
+/* Hängt eine Instruktion an und liefert ihren Index */
+static int emit(Program *prog, OpCode op) {
+    if (prog->len == prog->cap) {
+        // Wie die Token-Liste im Parser: verdoppeln, der alte Block bleibt in der Arena
+        int cap = prog->cap == 0 ? 16 : 2 * prog->cap;
+        Instruction *bigger = arena_alloc(&parse_arena, cap * sizeof(Instruction));
+        if (prog->len > 0)
+            memcpy(bigger, prog->code, prog->len * sizeof(Instruction));
+        prog->code = bigger;
+        prog->cap = cap;
+    }
+    prog->code[prog->len] = (Instruction){ .op = op };
+    return prog->len++;
+}
+
+static void compile_node(Program *prog, Command *cmd, int last, int depth);
+
+/*
+ * ";", "&&" und "||" hängen links (a ; b ; c = SEQUENCE(SEQUENCE(a, b), c)). Die Kette
+ * wird als Array gesammelt und von unten nach oben übersetzt, damit lange Zeilen die
+ * Rekursion nicht vertiefen; rekursiv geht es nur in die rechten Operanden.
+ */
+#define SPINE_STACK 64   // kürzere Ketten kommen ohne malloc aus
+
+static void compile_chain(Program *prog, Command *cmd, int last, int depth) {
+    Command *stack[SPINE_STACK];
+    Command **spine = stack;
+    int count = 0, cap = SPINE_STACK;
+
+    while (cmd->command_type == C_SEQUENCE || cmd->command_type == C_AND || cmd->command_type == C_OR) {
+        if (count == cap) {
+            cap *= 2;
+            spine = spine == stack ? malloc(cap * sizeof(Command *)) : realloc(spine, cap * sizeof(Command *));
+            if (spine == NULL) {
+                perror("program");
+                exit(EXIT_FAILURE);
+            }
+            if (count == SPINE_STACK)
+                memcpy(spine, stack, sizeof(stack));
+        }
+        spine[count++] = cmd;
+        cmd = cmd->left;
+    }
+    compile_node(prog, cmd, 0, depth);
+
+    for (int i = count - 1; i >= 0; i--) {
+        int jump = -1;
+        // Nur der rechte Operand ganz oben kann der letzte Befehl der Zeile sein
+        int right_last = last && i == 0;
+
+        if (spine[i]->command_type == C_AND)
+            jump = emit(prog, OP_JUMP_IF_FAIL);
+        else if (spine[i]->command_type == C_OR)
+            jump = emit(prog, OP_JUMP_IF_OK);
+        compile_node(prog, spine[i]->right, right_last, depth);
+        if (jump >= 0)
+            prog->code[jump].target = prog->len;
+    }
+    if (spine != stack)
+        free(spine);
+}
+
+/*
+ * if: bei Fehlschlag der Bedingung zum else-Teil, sonst then-Teil und darüber springen.
+ * Ohne else ist der Status danach 0 wie in der bash. Die Bedingung ist nie der letzte
+ * Befehl der Zeile, die beiden Zweige schon.
+ */
+static void compile_if(Program *prog, Command *cmd, int last, int depth) {
+    int to_else, to_end, op;
+
+    compile_node(prog, cmd->left, 0, depth);
+    to_else = emit(prog, OP_JUMP_IF_FAIL);
+    compile_node(prog, cmd->right, last, depth);
+    to_end = emit(prog, OP_JUMP);
+    prog->code[to_else].target = prog->len;
+    if (cmd->otherwise != NULL) {
+        compile_node(prog, cmd->otherwise, last, depth);
+    } else {
+        op = emit(prog, OP_STATUS);
+        prog->code[op].u.value = 0;
+    }
+    prog->code[to_end].target = prog->len;
+}
+
+/*
+ * while: Bedingung und Rumpf stehen einmal im Programm, OP_JUMP führt zurück zur
+ * Bedingung. Der Status der Schleife ist der des Rumpfs aus der letzten Runde, er
+ * wird im eigenen Platz gemerkt, weil die gescheiterte Bedingung ihn überschreibt.
+ */
+static void compile_while(Program *prog, Command *cmd, int depth) {
+    int slot = prog->slots++;
+    int start, to_end, op;
+
+    op = emit(prog, OP_STATUS);
+    prog->code[op].u.value = 0;
+    op = emit(prog, OP_SAVE);
+    prog->code[op].u.value = slot;
+    start = prog->len;
+    compile_node(prog, cmd->left, 0, depth);
+    to_end = emit(prog, OP_JUMP_IF_FAIL);
+    // Im Rumpf folgt immer noch die nächste Runde, also nie OP_FLAG_LAST
+    compile_node(prog, cmd->right, 0, depth);
+    op = emit(prog, OP_SAVE);
+    prog->code[op].u.value = slot;
+    op = emit(prog, OP_JUMP);
+    prog->code[op].target = start;
+    prog->code[to_end].target = prog->len;
+    op = emit(prog, OP_LOAD);
+    prog->code[op].u.value = slot;
+}
+
+/* Inhalt einer Gruppe, ihre Umleitungen gelten bis OP_RESTORE */
+static void compile_group(Program *prog, Command *cmd, int last, int depth) {
+    int op;
+
+    if (cmd->redirect == NULL) {
+        compile_node(prog, cmd->left, last, depth);
+        return;
+    }
+    // Nach dem Inhalt kommt noch RESTORE, ein exec wäre also zu früh
+    if (depth + 1 > prog->depth)
+        prog->depth = depth + 1;
+    op = emit(prog, OP_REDIRECT);
+    prog->code[op].u.simple = cmd->redirect;
+    compile_node(prog, cmd->left, 0, depth + 1);
+    emit(prog, OP_RESTORE);
+    prog->code[op].target = prog->len;
+}
+
+/*
+ * ( ... ): das Kind führt den Inhalt aus und endet mit OP_EXIT. Danach kommt für
+ * das Kind nichts mehr, sein letzter Befehl darf es also per exec ersetzen.
+ */
+static void compile_subshell(Program *prog, Command *cmd, int depth) {
+    int op = emit(prog, OP_SUBSHELL);
+
+    compile_group(prog, cmd, 1, depth);
+    emit(prog, OP_EXIT);
+    prog->code[op].target = prog->len;
+}
+
+static void compile_node(Program *prog, Command *cmd, int last, int depth) {
+    int op;
+
+    switch (cmd->command_type) {
+    case C_EMPTY:
+        break;
+    case C_SIMPLE:
+        op = emit(prog, OP_SIMPLE);
+        prog->code[op].u.simple = cmd->command_sequence->command_list->head;
+        prog->code[op].flags = last ? OP_FLAG_LAST : 0;
+        prog->code[op].builtin = builtin_for(prog->code[op].u.simple->command_tokens);
+        break;
+    case C_PIPE:
+        op = emit(prog, OP_PIPE);
+        prog->code[op].u.pipe = cmd;
+        break;
+    case C_SEQUENCE:
+    case C_AND:
+    case C_OR:
+        compile_chain(prog, cmd, last, depth);
+        break;
+    case C_GROUP:
+        compile_group(prog, cmd, last, depth);
+        break;
+    case C_SUBSHELL:
+        compile_subshell(prog, cmd, depth);
+        break;
+    case C_IF:
+        compile_if(prog, cmd, last, depth);
+        break;
+    case C_WHILE:
+        compile_while(prog, cmd, depth);
+        break;
+    default:
+        fprintf(stderr, "-bshell: command type %d cannot be compiled\n", cmd->command_type);
+        break;
+    }
+}
+
+/*
+ * Sprung auf einen Sprung: dieselbe Bedingung und OP_JUMP springen dort sicher auch,
+ * die entgegengesetzte Bedingung sicher nicht. "a && b && c" springt so bei a gleich
+ * ans Ende. Bedingte Sprünge gehen nur vorwärts; von hinten bearbeitet ist jedes Ziel
+ * schon fertig, eine lange Kette kostet also nicht quadratisch viele Schritte.
+ * Rückwärts springt nur OP_JUMP an den Anfang einer Schleifenbedingung, und dort
+ * steht nie ein Sprung.
+ */
+static void thread_jumps(Program *prog) {
+    for (int i = prog->len - 1; i >= 0; i--) {
+        Instruction *ins = &prog->code[i];
+        if (ins->op != OP_JUMP_IF_OK && ins->op != OP_JUMP_IF_FAIL && ins->op != OP_JUMP)
+            continue;
+        for (;;) {
+            Instruction *next = &prog->code[ins->target];
+            if (next->op == OP_JUMP || next->op == ins->op)
+                ins->target = next->target;
+            else if (ins->op != OP_JUMP && (next->op == OP_JUMP_IF_OK || next->op == OP_JUMP_IF_FAIL))
+                ins->target++;
+            else
+                break;
+        }
+    }
+}
+
+Program * program_compile(Command *cmd) {
+    Program *prog = arena_calloc(&parse_arena, 1, sizeof(Program));
+
+    compile_node(prog, cmd, 1, 0);
+    emit(prog, OP_END);
+    thread_jumps(prog);
+    return prog;
+}
+
+static const char *op_names[] = {
+    [OP_SIMPLE] = "SIMPLE",
+    [OP_PIPE] = "PIPE",
+    [OP_JUMP_IF_OK] = "JUMP_IF_OK",
+    [OP_JUMP_IF_FAIL] = "JUMP_IF_FAIL",
+    [OP_REDIRECT] = "REDIRECT",
+    [OP_RESTORE] = "RESTORE",
+    [OP_JUMP] = "JUMP",
+    [OP_STATUS] = "STATUS",
+    [OP_SAVE] = "SAVE",
+    [OP_LOAD] = "LOAD",
+    [OP_SUBSHELL] = "SUBSHELL",
+    [OP_EXIT] = "EXIT",
+    [OP_END] = "END",
+};
+
+void program_print(const Program *prog) {
+    printf("--- PROGRAM ---\n");
+    for (int i = 0; i < prog->len; i++) {
+        const Instruction *ins = &prog->code[i];
+        printf("%4d  %-13s", i, op_names[ins->op]);
+        switch (ins->op) {
+        case OP_SIMPLE:
+            printf(" %s%s%s%s", ins->u.simple->command_tokens[0],
+                   ins->u.simple->background ? " &" : "", ins->builtin != NULL ? "  (builtin)" : "",
+                   ins->flags & OP_FLAG_LAST ? "  (last)" : "");
+            break;
+        case OP_PIPE:
+            printf(" %s ... [%d]", ((SimpleCommand *)ins->u.pipe->command_sequence->command_list->head)->command_tokens[0],
+                   ins->u.pipe->command_sequence->command_list_len);
+            break;
+        case OP_JUMP_IF_OK:
+        case OP_JUMP_IF_FAIL:
+        case OP_REDIRECT:
+        case OP_SUBSHELL:
+        case OP_JUMP:
+            printf(" %d", ins->target);
+            break;
+        case OP_STATUS:
+            printf(" %d", ins->u.value);
+            break;
+        case OP_SAVE:
+        case OP_LOAD:
+            printf(" [%d]", ins->u.value);
+            break;
+        default:
+            break;
+        }
+        printf("\n");
+    }
+    printf("<<<< PROGRAM >>>>\n");
+}
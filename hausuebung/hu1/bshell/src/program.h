@@ -0,0 +1,103 @@
+/*
+ * program.h
+ *
+ * Übersetzt den Operatorbaum eines Befehls (siehe command.h) in ein flaches
+ * Array von Instruktionen. execute.c arbeitet es in einer Schleife ab, statt
+ * bei jeder Ausführung den Baum abzulaufen: "&&" und "||" werden zu bedingten
+ * Sprüngen auf den Status des letzten Befehls, Gruppen zu REDIRECT/RESTORE.
+ *
+ *   a && b || c ; d | e        0  SIMPLE        a
+ *                              1  JUMP_IF_FAIL  4
+ *                              2  SIMPLE        b
+ *                              3  JUMP_IF_OK    5
+ *                              4  SIMPLE        c
+ *                              5  PIPE          d | e
+ *                              6  END
+ *
+ * Ein Sprung auf einen weiteren Sprung wird gleich zum endgültigen Ziel
+ * (1: scheitert a, springt 3 sicher nicht, also direkt zu c).
+ *
+ * if und while werden zu Sprüngen, der Rumpf einer Schleife steht nur einmal im
+ * Programm und läuft in jeder Runde von dort, ohne neues Parsen oder Anlegen.
+ * Ihren Status (letzter Befehl des Rumpfs, 0 ohne Durchlauf) hält ein Platz:
+ *
+ *   while a; do b; done        0  STATUS        0
+ *                              1  SAVE          [0]
+ *                              2  SIMPLE        a
+ *                              3  JUMP_IF_FAIL  7
+ *                              4  SIMPLE        b
+ *                              5  SAVE          [0]
+ *                              6  JUMP          2
+ *                              7  LOAD          [0]
+ *                              8  END
+ *
+ * "( ... )" läuft in einem Kind: OP_SUBSHELL forkt, das Kind arbeitet den Inhalt
+ * ab und endet mit OP_EXIT, die Shell wartet und springt dahinter.
+ *
+ *   (cd /; ls); pwd            0  SUBSHELL      4
+ *                              1  SIMPLE        cd
+ *                              2  SIMPLE        ls  (last)
+ *                              3  EXIT
+ *                              4  SIMPLE        pwd
+ *                              5  END
+ *
+ * Builtins sind schon beim Übersetzen gebunden, den Pfad eines Programms sucht
+ * execute.c beim ersten Start und merkt ihn sich in der Instruktion.
+ *
+ */
+
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include "command.h"
+#include "builtins.h"
+
+typedef enum {
+    OP_SIMPLE,        /* einfacher Befehl (u.simple), setzt den Status */
+    OP_PIPE,          /* Pipe (u.pipe) starten und warten, setzt den Status */
+    OP_JUMP_IF_OK,    /* weiter bei target, wenn der Status 0 ist */
+    OP_JUMP_IF_FAIL,  /* weiter bei target, wenn der Status nicht 0 ist */
+    OP_REDIRECT,      /* Umleitungen einer Gruppe (u.simple) in der Shell setzen; scheitert das, weiter bei target */
+    OP_RESTORE,       /* die zuletzt gesetzten Umleitungen zurücknehmen */
+    OP_JUMP,          /* weiter bei target (auch rückwärts: Schleifen) */
+    OP_STATUS,        /* Status auf u.value setzen (if ohne else, leere Schleife) */
+    OP_SAVE,          /* Status im Platz u.value merken (Status einer Schleife) */
+    OP_LOAD,          /* Status aus dem Platz u.value holen */
+    OP_SUBSHELL,      /* Kind starten, das ab der nächsten Instruktion läuft; die Shell wartet und macht bei target weiter */
+    OP_EXIT,          /* Ende des Kinds einer Subshell, mit dem Status als Exit-Code */
+    OP_END
+} OpCode;
+
+/* OP_SIMPLE: danach läuft in dieser Zeile nichts mehr (exec statt Prozessstart möglich) */
+#define OP_FLAG_LAST 1
+
+typedef struct {
+    OpCode op;
+    int flags;        /* OP_FLAG_LAST */
+    int target;       /* Sprünge, OP_REDIRECT und OP_SUBSHELL: Index einer Instruktion */
+    union {
+        SimpleCommand *simple;
+        Command *pipe;
+        int value;
+    } u;
+    /* OP_SIMPLE: einmal aufgelöst, gilt für alle Runden einer Schleife */
+    const Builtin *builtin;   /* beim Übersetzen gebunden, NULL = Programm */
+    const char *path;         /* Pfad aus dem pathcache, NULL = noch nicht gesucht */
+    unsigned long generation; /* pathcache_generation() beim Suchen */
+} Instruction;
+
+typedef struct {
+    Instruction *code;
+    int len;
+    int cap;
+    int depth;        /* größte Schachtelung von OP_REDIRECT (Platz für die gesicherten fds) */
+    int slots;        /* Plätze für OP_SAVE/OP_LOAD, einer pro Schleife */
+} Program;
+
+/* Übersetzt <cmd> (nach command_materialize). Programm und Code liegen in der parse_arena. */
+Program * program_compile(Command *cmd);
+
+/* Gibt das Programm lesbar aus (Debug, wie command_print) */
+void program_print(const Program *prog);
+
+#endif /* PROGRAM_H */
@@ -1,93 +1,220 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "shell.h"
 #include "types.h"
 #include "command.h"
 #include "list.h"
 #include "debug.h"
 #include "helper.h"
+#include "readlineparsing.h"
+#include "eventloop.h"
+
+/*
+ * Non-interactive input (shell -c 'cmd' or shell script.bsh).
+ * Strings and regular script files are served from memory (the file is mmap'd),
+ * other files (pipes, /dev/stdin) are read() in chunks.
+ * If neither is set, input comes from readline/stdin.
+ */
+static const char *input_pos = NULL;
+static const char *input_end = NULL;
+static int input_fd = -1;
+static int input_eof = 0;
+/* last character handed to the scanner, used to terminate the last line with \n */
+static int input_last = '\n';
+
+void input_from_string(const char *str){
+    input_pos = str;
+    input_end = str + strlen(str);
+}
+
+int input_from_file(const char *path){
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            input_pos = map;
+            input_end = input_pos + st.st_size;
+            return 0;
+        }
+    }
+    input_fd = fd;
+    return 0;
+}
+
+static int batch_input(char *buf, int max_size){
+    int n = 0;
+    if (input_pos != NULL) {
+        n = input_end - input_pos;
+        if (n > max_size) n = max_size;
+        memcpy(buf, input_pos, n);
+        input_pos += n;
+    } else if (!input_eof) {
+        do {
+            n = read(input_fd, buf, max_size);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            input_eof = 1;
+            n = 0;
+        }
+    }
+
+    if (n == 0) {
+        /* the grammar needs a \n after every command, even after the last one */
+        if (input_last != '\n' && max_size > 0) {
+            input_last = '\n';
+            buf[0] = '\n';
+            return 1;
+        }
+        return 0;
+    }
+    input_last = (unsigned char)buf[n - 1];
+    return n;
+}
+
+int input_exhausted(){
+    if (yy_scanner_pending()) {
+        return 0;
+    }
+    if (input_pos != NULL) {
+        while (input_pos < input_end && (*input_pos == ' ' || *input_pos == '\t' || *input_pos == '\n')) {
+            input_pos++;
+        }
+        return input_pos == input_end;
+    }
+    if (input_fd != -1) {
+        /* we cannot look ahead into a pipe without consuming it, so only a seen EOF counts */
+        return input_eof;
+    }
+    /* interactive input is never known to be finished */
+    return 0;
+}
 
 #ifndef NOLIBREADLINE
+#include <poll.h>
 #include <readline/readline.h>
 
-/* Call this to get the next character of input. */
 char *current_readline_prompt = (char *)NULL;
 char *current_readline_line = (char *)NULL;
 int current_readline_line_index = 0;
+int current_readline_line_len = 0;
 
 
 /*
- * This code is mainly copied from BASH
+ * Input hook for readline: waits for a key and for finished children at the
+ * same time, so background jobs are reported while the user is typing.
  */
 static int
-yy_readline_get (){
-    int line_len;
-    unsigned char c;
+yy_readline_getc (FILE *stream){
+    struct pollfd fds[2] = {
+        { fileno(stream), POLLIN, 0 },
+        { eventloop_fd(), POLLIN, 0 },
+    };
+
+    for (;;){
+        if (poll(fds, 2, -1) < 0){
+            /* let readline handle the signal (e.g. SIGWINCH) in rl_getc */
+            return rl_getc(stream);
+        }
+        if ((fds[1].revents & POLLIN) && eventloop_reap() > 0){
+            /* report below the current input and draw prompt and input again */
+            fputc('\n', rl_outstream);
+            eventloop_notify();
+            rl_on_new_line();
+            rl_redisplay();
+        }
+        if (fds[0].revents){
+            return rl_getc(stream);
+        }
+    }
+}
+
+/*
+ * This code is mainly copied from BASH, but hands the scanner the rest of the
+ * current line at once instead of a single character per call.
+ */
+static int
+yy_readline_input (char *buf, int max_size){
+    int n;
     if (current_readline_line == 0){
+        rl_getc_function = yy_readline_getc;
         /* our prompt comes directly from the shell and not frome here!*/
         current_readline_line = readline (current_readline_prompt);
 
         /* after the prompt is used for the first time, we can reset it here to a different value for multiline input! */
         sprintf(current_readline_prompt, ">| ");
         if (current_readline_line == 0){
-            return(EOF);
+            return 0;
         }
         current_readline_line_index = 0;
-        line_len = strlen (current_readline_line);
+        current_readline_line_len = strlen (current_readline_line);
         /* we need two additional bytes for \n\0*/
-        current_readline_line = (char *)realloc (current_readline_line, 2 + line_len);
+        current_readline_line = (char *)realloc (current_readline_line, 2 + current_readline_line_len);
         /* readline does not add \n to a line!*/
-        current_readline_line[line_len++] = '\n';
+        current_readline_line[current_readline_line_len++] = '\n';
         /*terminate the current string!*/
-        current_readline_line[line_len] = '\0';
+        current_readline_line[current_readline_line_len] = '\0';
     }
 
-    if (current_readline_line[current_readline_line_index] == 0)
-    {
+    n = current_readline_line_len - current_readline_line_index;
+    if (n > max_size)
+        n = max_size;
+    memcpy(buf, current_readline_line + current_readline_line_index, n);
+    current_readline_line_index += n;
+
+    /* line fully handed over: the next call reads a new line (continuation prompt) */
+    if (current_readline_line_index == current_readline_line_len){
         free (current_readline_line);
         current_readline_line = (char *)NULL;
-        return (yy_readline_get ());
-    }
-    else
-    {
-        c = current_readline_line[current_readline_line_index++];
-
-        return (c);
     }
+    return n;
 }
-
-#if 0
+#else
+/*
+ * Without libreadline: one line per call. We must not read beyond the line,
+ * because started commands inherit stdin from the shell. fgets() on the
+ * buffered stdin would read ahead (a whole block from a pipe or file), so the
+ * line is read with read(2) byte by byte, as sh does for unseekable input.
+ */
 static int
-yy_readline_unget (c)
-    int c;
-{
-    if (current_readline_line_index && current_readline_line)
-        current_readline_line[--current_readline_line_index] = c;
-    return (c);
+yy_stdin_input (char *buf, int max_size){
+    int n = 0;
+    while (n < max_size){
+        ssize_t r = read(STDIN_FILENO, buf + n, 1);
+        if (r < 0 && errno == EINTR){
+            continue;
+        }
+        if (r <= 0){
+            break;
+        }
+        if (buf[n++] == '\n'){
+            break;
+        }
+    }
+    return n;
 }
-#endif /* 0 */
 #endif /* NOLIBREADLINE */
 
-int yy_getc () {
+int yy_input (char *buf, int max_size) {
+    if (input_pos != NULL || input_fd != -1) {
+        return batch_input(buf, max_size);
+    }
 #ifndef NOLIBREADLINE
-    return (*(yy_readline_get)) ();
+    return yy_readline_input(buf, max_size);
 #else
-    return (*(getchar)) ();
+    return yy_stdin_input(buf, max_size);
 #endif
-
-}
-
-/* Call this to unget C.  That is, to make C the next character
-   to be read. */
-#if 0
-static int
-yy_ungetc (c)
-    int c;
-{
-    return (*(yy_readline_unget)) (c);
 }
-#endif
-
@@ -0,0 +1,49 @@
+#ifndef READLINEPARSING_H
+
+#define READLINEPARSING_H
+
+/*
+ * Input sources for the scanner. By default the scanner reads through readline
+ * (or stdin without libreadline). For batch mode, one of the following
+ * replaces the interactive input.
+ */
+
+/* read the commands from a string (shell -c 'cmd') */
+void input_from_string(const char *str);
+
+/* read the commands from a script file, returns -1 if it cannot be opened */
+int input_from_file(const char *path);
+
+/* returns 1 if only blanks and newlines are left in a non-interactive input */
+int input_exhausted();
+
+/*
+ * Fills buf with up to max_size bytes of input for YY_INPUT, i.e. the rest of the
+ * current readline line or a whole chunk of the batch input. Returns 0 at EOF.
+ */
+int yy_input(char *buf, int max_size);
+
+/* implemented by the scanner: 1 if it buffered unread input other than blanks/newlines */
+int yy_scanner_pending();
+
+/*
+ * implemented by the scanner: reads the next raw input line (for here-documents),
+ * directly behind the last token. *line points to the line without '\n' and is
+ * valid until the next call. Returns its length or -1 at EOF.
+ */
+long yy_read_line(char **line);
+
+/*
+ * implemented by the scanner: start of the text that the token spans of the last
+ * parsed line refer to. Valid until the scanner reads the next line.
+ */
+char * yy_token_base();
+
+/*
+ * implemented by the scanner, called by the parser when a line is complete. The
+ * next token starts a new line; until then the spans of the line stay valid.
+ * A '\n' inside an if or while does not end the line.
+ */
+void yy_line_done();
+
+#endif /* end of include guard: READLINEPARSING_H */
@@ -14,7 +14,12 @@
 #include <fcntl.h>
 #include "statuslist.h"
 #include "execute.h"
+#include "eventloop.h"
 #include "debug.h"
+#include "readlineparsing.h"
+#include "arena.h"
+#include "pathcache.h"
+#include <time.h>
 
 #ifndef NOLIBREADLINE
 #include <readline/readline.h>
@@ -26,14 +31,16 @@
  * Du musst dich darum nicht kümmern – sie funktioniert!
  */
 extern Command * cmd;
-extern List *statuslist;
 
 #ifndef NOLIBREADLINE
 extern char *current_readline_prompt; // Prompt wie z. B. bshell [/home/user]>, wo Benutzer Befehle eingeben können
 #endif
 
-int fdtty;
+int fdtty = -1;
 int shell_pid;
+int shell_interactive = 1;
+int shell_input_done = 0;
+static int last_status = 0; // Exit-Status des letzten Befehls, wird im Batchbetrieb zum Exit-Code der Shell
 
 /* Deklaration für die Parserfunktionen und -strukturen */
 typedef struct yy_buffer_state * YY_BUFFER_STATE;
@@ -67,17 +74,42 @@ void disable_signals() {
 }
 
 /**
- * Signalhandler für SIGCHLD – wird aufgerufen, wenn ein Kindprozess beendet wurde.
- * Verhindert Zombie-Prozesse durch regelmäßiges Aufräumen via waitpid().
+ * Ende der Eingabe (Ctrl+D bzw. Ende von -c / Skript).
  */
-void sigchld_handler(int signo) {
-    int status;
-    pid_t pid;
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        if (WIFEXITED(status) || WIFSIGNALED(status)) {
-            statuslist_update(pid, status);  // Aktualisiert die Liste der Kinderprozesse
-        }
+void shell_exit_on_eof() {
+    if (shell_interactive) {
+        fprintf(stdout, "\n");
+        exit(1);
     }
+    exit(last_status);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--print-commands] [--parse-stats] [--inflate-heap=MB] [-n] [-c command | script]\n", name);
+    exit(2);
+}
+
+/*
+ * Für den Benchmark (spawn_rss_*): belegt <mb> MiB Heap und beschreibt ihn, damit
+ * die Seiten wirklich zum RSS zählen. Zeigt, was ein Prozessstart bei großer Shell kostet.
+ */
+static void inflate_heap(const char *mb, const char *name) {
+    static char *heap = NULL;
+    char *end;
+    long n = strtol(mb, &end, 10);
+
+    if (*mb == '\0' || *end != '\0' || n < 0 || heap != NULL) {
+        usage(name);
+    }
+    if (n == 0) {
+        return;
+    }
+    heap = malloc((size_t)n << 20);
+    if (heap == NULL) {
+        perror("inflate-heap");
+        exit(1);
+    }
+    memset(heap, 1, (size_t)n << 20);
 }
 
 /**
@@ -85,25 +117,48 @@ void sigchld_handler(int signo) {
  */
 int main(int argc, char *argv[], char **envp) {
     char *line = NULL;
+    int print_commands = 0;
+    int parse_stats = 0;
+    int parse_only = 0;
+    int argi = 1;
+
+    for (; argi < argc && (strncmp(argv[argi], "--", 2) == 0 || strcmp(argv[argi], "-n") == 0); argi++) {
+        if (strcmp(argv[argi], "--print-commands") == 0) {
+            print_commands = 1; // Aktiviert Debug-Ausgabe der eingegebenen Befehle
+            execute_print_program = 1; // ... und der Instruktionen, die execute() abarbeitet
+        } else if (strcmp(argv[argi], "--parse-stats") == 0) {
+            parse_stats = 1;    // Parse-Dauer und Arena-Belegung pro Zeile auf stderr
+        } else if (strcmp(argv[argi], "-n") == 0) {
+            parse_only = 1;     // Nur parsen, nichts ausführen (wie sh -n)
+        } else if (strncmp(argv[argi], "--inflate-heap=", 15) == 0) {
+            inflate_heap(argv[argi] + 15, argv[0]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (argi < argc) {
+        // Batchbetrieb: kein Terminal, keine Jobkontrolle, kein readline
+        shell_interactive = 0;
+        if (strcmp(argv[argi], "-c") == 0) {
+            if (argi + 1 >= argc) usage(argv[0]);
+            input_from_string(argv[argi + 1]);
+        } else if (input_from_file(argv[argi]) < 0) {
+            fprintf(stderr, "-bshell: %s: %s\n", argv[argi], strerror(errno));
+            exit(127);
+        }
+    }
 
-    disable_signals(); // Signale wie Ctrl+C deaktivieren
-
-    // SIGCHLD-Handler einrichten: Aufräumen beendeter Kindprozesse
-    struct sigaction sa;
-    sa.sa_handler = sigchld_handler;
-    sigemptyset(&sa.sa_mask); // Keine Signale während des Handlers blockieren
-    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
-    sigaction(SIGCHLD, &sa, NULL);
-
-    // Öffnet das Terminal direkt (für Gruppensteuerung)
-    fdtty = open("/dev/tty", O_RDONLY | O_CLOEXEC);
+    // Kinder werden nur noch über signalfd/epoll eingesammelt (kein SIGCHLD-Handler)
+    eventloop_init();
     shell_pid = getpid();           // PID der Shell speichern
-    setpgid(0, shell_pid);          // Neue Prozessgruppe für die Shell setzen
-    tcsetpgrp(fdtty, shell_pid);    // Kontrolle über das Terminal übernehmen
 
-    int print_commands = 0;
-    if (argc > 1) {
-        print_commands = strcmp(argv[1], "--print-commands") == 0 ? 1 : 0; // Aktiviert Debug-Ausgabe der eingegebenen Befehle
+    if (shell_interactive) {
+        disable_signals(); // Signale wie Ctrl+C deaktivieren
+
+        // Öffnet das Terminal direkt (für Gruppensteuerung)
+        fdtty = open("/dev/tty", O_RDONLY | O_CLOEXEC);
+        setpgid(0, shell_pid);          // Neue Prozessgruppe für die Shell setzen
+        tcsetpgrp(fdtty, shell_pid);    // Kontrolle über das Terminal übernehmen
     }
 
 #ifndef NOLIBREADLINE
@@ -115,22 +170,43 @@ int main(int argc, char *argv[], char **envp) {
         int parser_res;
         char cwd[256]; // Aktuelles Arbeitsverzeichnis
 
-        if (getcwd(cwd, sizeof(cwd)) == NULL) {
-            perror("getcwd");
-            cwd[0] = '\0';
+        eventloop_reap(); // Beendete Hintergrundjobs eintragen
+        pathcache_release(); // Pfade veralteter pathcache-Einträge hält jetzt niemand mehr
+        if (shell_interactive) {
+            eventloop_notify(); // ... und vor dem Prompt melden
         }
 
+        if (shell_interactive) {
+            if (getcwd(cwd, sizeof(cwd)) == NULL) {
+                perror("getcwd");
+                cwd[0] = '\0';
+            }
+
 #ifndef NOLIBREADLINE
-        sprintf(current_readline_prompt, "bshell [%s]> ", cwd); // Prompt zusammensetzen
+            sprintf(current_readline_prompt, "bshell [%s]> ", cwd); // Prompt zusammensetzen
 #else
-        printf("bshell [%s]> ", cwd);
+            printf("bshell [%s]> ", cwd);
 #endif
-        fflush(stdout); // Stellt sicher, dass das Prompt sofort angezeigt wird
+            fflush(stdout); // Stellt sicher, dass das Prompt sofort angezeigt wird
+        }
 
+        struct timespec parse_start, parse_end;
+        clock_gettime(CLOCK_MONOTONIC, &parse_start);
         parser_res = yyparse(); // Startet den Parser (Analyse der Benutzereingabe)
+        clock_gettime(CLOCK_MONOTONIC, &parse_end);
+
+        if (parse_stats) {
+            // Dauer enthält auch das Lesen der Zeile (im Batchbetrieb nur ein memcpy)
+            long ns = (parse_end.tv_sec - parse_start.tv_sec) * 1000000000L
+                    + (parse_end.tv_nsec - parse_start.tv_nsec);
+            fprintf(stderr, "[parse] %.3f us, %zu allocations, %zu bytes, %zu arena blocks malloc'd\n",
+                    ns / 1000.0, parse_arena.allocations, parse_arena.bytes, parse_arena.block_mallocs);
+        }
 
         if (parser_res == 0) { // Erfolgreich geparst
-            if ((line = command_get(cmd)) != NULL) {
+            command_materialize(cmd, yy_token_base()); // argv aus den Token-Ausschnitten bauen
+
+            if (shell_interactive && (line = command_get(cmd)) != NULL) {
 #ifndef NOLIBREADLINE
                 add_history(line); // Zur Verlaufsliste hinzufügen
 #endif
@@ -141,8 +217,11 @@ int main(int argc, char *argv[], char **envp) {
                 command_print(cmd); // Optional: gibt intern analysierten Befehl aus
             }
 
-            execute(cmd);         // Führt den Befehl aus (Fork + Exec)
-            command_delete(cmd); // Bereinigt den Speicher
+            if (!parse_only) {
+                shell_input_done = input_exhausted(); // Erlaubt exec statt Fork für den letzten Befehl
+                last_status = execute(cmd);         // Führt den Befehl aus (Spawn bzw. Builtin)
+            }
+            command_delete(cmd); // Bereinigt den Speicher (O(1): Reset der parse_arena)
         } else if (parser_res == 1) {
             fprintf(stderr, "[%s %s %i] Parser-Fehler: yyerror ausgelöst (parser_res = 1)!\n",
                     __FILE__, __func__, __LINE__);
@@ -153,6 +232,10 @@ int main(int argc, char *argv[], char **envp) {
             fprintf(stderr, "[%s %s %i] Schwerwiegender Parser-Fehler (parser_res = %i)\n",
                     __FILE__, __func__, __LINE__, parser_res);
         }
+        if (parser_res != 0) {
+            last_status = 2; // Syntaxfehler wie in der bash
+            command_delete(NULL); // Reste der fehlerhaften Zeile verwerfen (parse_arena, Here-Dokumente)
+        }
     }
 }
 
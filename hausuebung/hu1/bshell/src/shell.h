@@ -2,6 +2,13 @@
 
 #define SHELL_H
 
+/* 1: interaktiv mit Terminal und Jobkontrolle, 0: Batchbetrieb (-c oder Skriptdatei) */
+extern int shell_interactive;
 
+/* 1: nach dem gerade ausgeführten Befehl folgt keine weitere Eingabe (nur Batchbetrieb) */
+extern int shell_input_done;
+
+/* Wird vom Parser am Ende der Eingabe aufgerufen und beendet die Shell */
+void shell_exit_on_eof();
 
 #endif /* end of include guard: SHELL_H */
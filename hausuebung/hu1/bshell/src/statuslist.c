@@ -1,14 +1,154 @@
 #define _GNU_SOURCE
 #include "statuslist.h"
-#include "list.h"
+#include "strpool.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/wait.h>
 #include <signal.h>
 
-List *statuslist = NULL;
+/*
+ * Jobtabelle in zwei Teilen:
+ *
+ * - Laufende Prozesse liegen dicht in <running>, <slots> ist ein Hash-Index
+ *   pid -> Position in <running> mit offener Adressierung (lineares Sondieren).
+ *   Der Index ist mindestens doppelt so gro wie <running>; Suchen, Einfgen und
+ *   Entfernen kosten O(1). Die Gre hngt nur von der Zahl gleichzeitig laufender
+ *   Prozesse ab.
+ *
+ * - Beendete Prozesse wandern beim Einsammeln in einen Ring fester Gre
+ *   (<retain_cap>, nderbar mit "status -r N"). Ist er voll, wird der lteste
+ *   Eintrag verdrngt und <evicted> hochgezhlt. Der Speicher bleibt damit auch
+ *   nach Tagen mit vielen Hintergrundjobs konstant.
+ *
+ * Befehlsnamen kommen aus dem Zeichenketten-Pool (strpool.c) statt aus strdup().
+ * Die Tabelle wird nur von der Hauptschleife verndert (eventloop_reap()).
+ */
+#define STATUSLIST_INITIAL 64
+#define STATUSLIST_RETAIN_DEFAULT 128
+#define SLOT_EMPTY -1
+
+static ProcessInfo *running = NULL;
+static int run_count = 0;
+static int run_cap = 0;
+static int *slots = NULL;
+static unsigned int slot_mask = 0;   // Anzahl Slots - 1 (Zweierpotenz)
+
+static ProcessInfo *finished = NULL; // Ring der beendeten Prozesse
+static int retain_cap = STATUSLIST_RETAIN_DEFAULT;
+static int fin_head = 0;             // ltester Eintrag
+static int fin_count = 0;
+static unsigned long evicted = 0;    // verdrngte Eintrge insgesamt
+
+static unsigned long next_seq = 0;   // Startreihenfolge fr die Ausgabe
+
+static unsigned int pid_hash(pid_t pid) {
+	return ((uint32_t)pid * 2654435761u) & slot_mask;
+}
+
+/* Position des Slots fr <pid>: entweder mit diesem pid belegt oder leer */
+static unsigned int slot_find(pid_t pid) {
+	unsigned int i = pid_hash(pid);
+	while (slots[i] != SLOT_EMPTY && running[slots[i]].pid != pid) {
+		i = (i + 1) & slot_mask;
+	}
+	return i;
+}
+
+/*
+ * Leert Slot <i> und rckt die folgenden Eintrge derselben Sondierkette nach
+ * (backward shift), damit keine Grabsteine ntig sind.
+ */
+static void slot_delete(unsigned int i) {
+	unsigned int j = i;
+
+	slots[i] = SLOT_EMPTY;
+	for (;;) {
+		j = (j + 1) & slot_mask;
+		if (slots[j] == SLOT_EMPTY) {
+			return;
+		}
+		unsigned int home = pid_hash(running[slots[j]].pid);
+		// Eintrag j darf nach i, wenn sein Heimat-Slot nicht zyklisch in (i, j] liegt
+		int stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+		if (!stays) {
+			slots[i] = slots[j];
+			slots[j] = SLOT_EMPTY;
+			i = j;
+		}
+	}
+}
+
+/* Baut den Index fr die laufenden Eintrge neu auf (nach dem Vergrern) */
+static void slots_rebuild(int slot_count) {
+	free(slots);
+	slots = malloc(slot_count * sizeof(int));
+	if (slots == NULL) {
+		perror("statuslist");
+		exit(1);
+	}
+	slot_mask = slot_count - 1;
+	for (int i = 0; i < slot_count; i++) {
+		slots[i] = SLOT_EMPTY;
+	}
+	for (int e = 0; e < run_count; e++) {
+		slots[slot_find(running[e].pid)] = e;
+	}
+}
+
+static void statuslist_grow() {
+	run_cap = run_cap == 0 ? STATUSLIST_INITIAL : run_cap * 2;
+	running = realloc(running, run_cap * sizeof(ProcessInfo));
+	if (running == NULL) {
+		perror("statuslist");
+		exit(1);
+	}
+	slots_rebuild(2 * run_cap);
+}
+
+/* Legt den Ring mit <retain_cap> Pltzen an (beim ersten beendeten Prozess) */
+static void finished_alloc() {
+	finished = malloc(retain_cap * sizeof(ProcessInfo));
+	if (finished == NULL) {
+		perror("statuslist");
+		exit(1);
+	}
+	fin_head = 0;
+	fin_count = 0;
+}
+
+/* Entfernt den ltesten beendeten Eintrag */
+static void finished_drop_oldest() {
+	strpool_release(finished[fin_head].command);
+	fin_head = (fin_head + 1) % retain_cap;
+	fin_count--;
+}
+
+/* Hngt <info> als neuesten beendeten Eintrag an, verdrngt notfalls den ltesten */
+static void finished_push(const ProcessInfo *info) {
+	if (finished == NULL) {
+		finished_alloc();
+	}
+	if (fin_count == retain_cap) {
+		finished_drop_oldest();
+		evicted++;
+	}
+	finished[(fin_head + fin_count) % retain_cap] = *info;
+	fin_count++;
+}
+
+/* Trgt das Ergebnis von waitpid in den Eintrag ein */
+static void set_status(ProcessInfo *info, int status) {
+	if (WIFEXITED(status)) {
+		info->status = EXITED;
+		info->code = WEXITSTATUS(status);
+	} else if (WIFSIGNALED(status)) {
+		info->status = SIGNALED;
+		info->code = WTERMSIG(status);
+	}
+}
 
 /**
  * Fgt einen neuen Prozess zur Statusliste hinzu.
@@ -17,115 +157,222 @@ List *statuslist = NULL;
  * - `command`: Kommando als String
  */
 void statuslist_add(pid_t pid, pid_t pgid, const char *command) {
-	ProcessInfo *info = malloc(sizeof(ProcessInfo));
+	if (run_count == run_cap) {
+		statuslist_grow();
+	}
+
+	ProcessInfo *info = &running[run_count];
 	info->pid = pid;
 	info->gpid = pgid;
 	info->status = RUNNING;
 	info->code = -1;
-	info->command = strdup(command);  // Kopie des Befehls
+	info->command = strpool_intern(command);  // gleiche Namen teilen sich eine Kopie
+	info->seq = next_seq++;
+	clock_gettime(CLOCK_MONOTONIC, &info->start);
+	info->end = info->start;
+	memset(&info->usage, 0, sizeof(info->usage));
 
-	statuslist = list_append(info, statuslist);  // Zur Liste hinzufgen
+	slots[slot_find(pid)] = run_count;
+	run_count++;
 }
 
 /**
  * Aktualisiert den Status eines Prozesses basierend auf seiner PID und dem Rckgabewert `status`.
+ * Der Eintrag wandert aus der Tabelle der laufenden Prozesse in den Ring.
  */
-void statuslist_update(pid_t pid, int status) {
-	List* current = statuslist;
+void statuslist_update(pid_t pid, int status, const struct rusage *usage) {
+	if (run_count == 0) {
+		return;
+	}
+	unsigned int slot = slot_find(pid);
+	int e = slots[slot];
+	if (e == SLOT_EMPTY) {
+		// Unbekannt (z. B. schon eingesammelt): nichts zu tun
+		return;
+	}
+
+	ProcessInfo *info = &running[e];
+	set_status(info, status);
+	clock_gettime(CLOCK_MONOTONIC, &info->end);
+	if (usage != NULL) {
+		info->usage = *usage;
+	}
+	finished_push(info);
 
-	while (current != NULL) {
-		ProcessInfo *info = (ProcessInfo*)current->head;
+	// Lcke mit dem letzten laufenden Eintrag fllen
+	slot_delete(slot);
+	run_count--;
+	if (e != run_count) {
+		slots[slot_find(running[run_count].pid)] = e;
+		running[e] = running[run_count];
+	}
+}
 
+/**
+ * Sucht den Eintrag zu <pid>, NULL wenn unbekannt oder schon verdrngt.
+ * Laufende Prozesse ber den Index, beendete vom neuesten zum ltesten
+ * (meist wird gerade ein eben beendeter Job gesucht).
+ */
+const ProcessInfo * statuslist_find(pid_t pid) {
+	if (run_count > 0) {
+		int e = slots[slot_find(pid)];
+		if (e != SLOT_EMPTY) {
+			return &running[e];
+		}
+	}
+	for (int i = fin_count - 1; i >= 0; i--) {
+		ProcessInfo *info = &finished[(fin_head + i) % retain_cap];
 		if (info->pid == pid) {
-			if (info->status != RUNNING) {
-				// Aktualisiere keinen bereits beendeten Prozess
-				return;
-			}
-
-			if (WIFEXITED(status)) {
-				info->status = EXITED;
-				info->code = WEXITSTATUS(status);
-			} else if (WIFSIGNALED(status)) {
-				info->status = SIGNALED;
-				info->code = WTERMSIG(status);
-			}
-			break;
+			return info;
 		}
+	}
+	return NULL;
+}
 
-		current = current->tail;
+/**
+ * Zustand als Text fr die Anzeige, z. B. "running", "exit(0)", "signal(9)".
+ */
+void statuslist_status_string(const ProcessInfo *info, char *buf, size_t size) {
+	if (info == NULL) {
+		snprintf(buf, size, "unknown");
+	} else if (info->status == RUNNING) {
+		snprintf(buf, size, "running");
+	} else if (info->status == EXITED) {
+		snprintf(buf, size, "exit(%d)", info->code);
+	} else if (info->status == SIGNALED) {
+		snprintf(buf, size, "signal(%d)", info->code);
+	} else {
+		snprintf(buf, size, "unknown");
 	}
 }
 
+static double timeval_ms(const struct timeval *tv) {
+	return tv->tv_sec * 1000.0 + tv->tv_usec / 1000.0;
+}
+
+/* neuester Start zuerst */
+static int compare_seq_desc(const void *a, const void *b) {
+	const ProcessInfo *x = *(const ProcessInfo * const *)a;
+	const ProcessInfo *y = *(const ProcessInfo * const *)b;
+	return (x->seq < y->seq) - (x->seq > y->seq);
+}
+
 /**
- * Gibt alle Prozesse der Liste aus und bereinigt beendete Eintrge.
- * Prozesse, die noch laufen, werden in einer neuen Liste behalten.
+ * Gibt alle Prozesse der Liste aus und leert den Ring der beendeten Eintrge.
+ * Prozesse, die noch laufen, bleiben in der Tabelle.
+ * Mit <verbose> kommen Laufzeit und die Werte aus wait4() dazu (laufende Prozesse: bisherige Laufzeit, sonst 0).
  */
-void statuslist_print_and_cleanup() {
-	List *current = statuslist;
-	List *newlist = NULL;
-
-	printf("%-5s %-5s %-12s %s\n", "PID", "PGID", "STATUS", "NAME");
-
-	while (current != NULL) {
-		ProcessInfo *info = (ProcessInfo*) current->head;
-
-		// Status aktualisieren, falls Prozess noch luft
-		if (info->status == RUNNING) {
-			int status;
-			pid_t result = waitpid(info->pid, &status, WNOHANG);
-			if (result == info->pid) {
-				if (WIFEXITED(status)) {
-					info->status = EXITED;
-					info->code = WEXITSTATUS(status);
-				} else if (WIFSIGNALED(status)) {
-					info->status = SIGNALED;
-					info->code = WTERMSIG(status);
-				}
-			}
-		}
+void statuslist_print_and_cleanup(int verbose) {
+	struct timespec now;
+	int total = run_count + fin_count;
+	const ProcessInfo **order = malloc((total > 0 ? total : 1) * sizeof(ProcessInfo *));
+	int n = 0;
+
+	if (order == NULL) {
+		perror("statuslist");
+		return;
+	}
+	for (int e = 0; e < run_count; e++) {
+		order[n++] = &running[e];
+	}
+	for (int i = 0; i < fin_count; i++) {
+		order[n++] = &finished[(fin_head + i) % retain_cap];
+	}
+	// neueste Eintrge zuerst (wie bei der frheren Liste)
+	qsort(order, n, sizeof(order[0]), compare_seq_desc);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (verbose) {
+		printf("%-5s %-5s %-12s %9s %9s %9s %9s %7s %7s %7s %7s %s\n", "PID", "PGID", "STATUS",
+		       "WALL_MS", "USER_MS", "SYS_MS", "RSS_KB", "MINFLT", "MAJFLT", "VCSW", "IVCSW", "NAME");
+	} else {
+		printf("%-5s %-5s %-12s %s\n", "PID", "PGID", "STATUS", "NAME");
+	}
+
+	for (int i = 0; i < n; i++) {
+		const ProcessInfo *info = order[i];
 
 		// Zeichenkette zur Anzeige vorbereiten
 		char status_str[32];
-		if (info->status == RUNNING) {
-			strcpy(status_str, "running");
-		} else if (info->status == EXITED) {
-			snprintf(status_str, sizeof(status_str), "exit(%d)", info->code);
-		} else if (info->status == SIGNALED) {
-			snprintf(status_str, sizeof(status_str), "signal(%d)", info->code);
+		statuslist_status_string(info, status_str, sizeof(status_str));
+
+		if (verbose) {
+			const struct timespec *end = info->status == RUNNING ? &now : &info->end;
+			double wall_ms = (end->tv_sec - info->start.tv_sec) * 1000.0
+			               + (end->tv_nsec - info->start.tv_nsec) / 1e6;
+			printf("%-5d %-5d %-12s %9.1f %9.1f %9.1f %9ld %7ld %7ld %7ld %7ld %s\n",
+			       info->pid, info->gpid, status_str, wall_ms,
+			       timeval_ms(&info->usage.ru_utime), timeval_ms(&info->usage.ru_stime),
+			       info->usage.ru_maxrss, info->usage.ru_minflt, info->usage.ru_majflt,
+			       info->usage.ru_nvcsw, info->usage.ru_nivcsw, info->command);
 		} else {
-			strcpy(status_str, "unknown");
+			printf("%-5d %-5d %-12s %s\n", info->pid, info->gpid, status_str, info->command);
 		}
+	}
+	if (evicted > 0) {
+		printf("(%lu finished jobs evicted, retention %d)\n", evicted, retain_cap);
+	}
+	free(order);
 
-		// Ausgabe und Freigabe je nach Status
-		printf("%-5d %-5d %-12s %s\n", info->pid, info->gpid, status_str, info->command);
+	// Beendete Eintrge sind gemeldet und werden entfernt
+	while (fin_count > 0) {
+		finished_drop_oldest();
+	}
+}
 
-		if (info->status == RUNNING) {
-			newlist = list_append(info, newlist);  // Noch laufende Prozesse behalten
-		} else {
-			free(info->command);
-			free(info);
+/**
+ * ndert die Gre des Rings der beendeten Eintrge (mindestens 1).
+ * Passen die vorhandenen nicht hinein, werden die ltesten verdrngt.
+ */
+int statuslist_set_retention(int capacity) {
+	if (capacity < 1) {
+		return -1;
+	}
+	if (finished != NULL) {
+		ProcessInfo *ring = malloc(capacity * sizeof(ProcessInfo));
+		if (ring == NULL) {
+			perror("statuslist");
+			return -1;
 		}
-
-		List *tmp = current;
-		current = current->tail;
-		free(tmp);
+		while (fin_count > capacity) {
+			finished_drop_oldest();
+			evicted++;
+		}
+		for (int i = 0; i < fin_count; i++) {
+			ring[i] = finished[(fin_head + i) % retain_cap];
+		}
+		free(finished);
+		finished = ring;
+		fin_head = 0;
 	}
+	retain_cap = capacity;
+	return 0;
+}
 
-	statuslist = newlist;
+int statuslist_retention() {
+	return retain_cap;
+}
+
+unsigned long statuslist_evicted() {
+	return evicted;
 }
 
 /**
  * Gibt den gesamten Speicher der Statusliste frei (inklusive aller Eintrge).
  */
 void statuslist_free() {
-	List *current = statuslist;
-	while (current != NULL) {
-		ProcessInfo *entry = (ProcessInfo*)current->head;
-		free(entry->command);
-		free(entry);
-		List *tmp = current;
-		current = current->tail;
-		free(tmp);
-	}
-	statuslist = NULL;
-}
\ No newline at end of file
+	for (int e = 0; e < run_count; e++) {
+		strpool_release(running[e].command);
+	}
+	while (fin_count > 0) {
+		finished_drop_oldest();
+	}
+	free(running);
+	free(slots);
+	free(finished);
+	running = NULL;
+	slots = NULL;
+	finished = NULL;
+	run_count = run_cap = 0;
+	slot_mask = 0;
+}
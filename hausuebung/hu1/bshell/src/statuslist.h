@@ -2,8 +2,10 @@
 
 #define STATUSLIST_H
 
-#include "list.h"
+#include <stddef.h>
+#include <time.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 
 
 // defini les etats possibles d'un processus
@@ -19,15 +21,21 @@ typedef struct{
 	pid_t gpid; //gpid des Prozesses
 	ProcessStatus status; // Zustand des Prozesses (RUNNING, EXITED, SIGNALED)
 	int code; // exit code
-	char *command; // ausgefhrter Befehle
+	const char *command; // ausgefhrter Befehl (aus strpool, nicht freigeben)
+	unsigned long seq; // Startreihenfolge
+	struct timespec start; // Start (CLOCK_MONOTONIC)
+	struct timespec end;   // Ende, beim Einsammeln
+	struct rusage usage;   // CPU-Zeit, max RSS, Seitenfehler, Kontextwechsel aus wait4()
 } ProcessInfo;
 
-// Liste globale des statuts de processus
-extern List *statuslist;
-
 void statuslist_add(pid_t pid, pid_t pgid, const char* command);
-void statuslist_update(pid_t pid, int status); // aufgerufen whrend des SIGCHLD
-void statuslist_print_and_cleanup();           // Commande status
+void statuslist_update(pid_t pid, int status, const struct rusage *usage); // aufgerufen von eventloop_reap()
+const ProcessInfo * statuslist_find(pid_t pid); // Eintrag zu pid oder NULL
+void statuslist_status_string(const ProcessInfo *info, char *buf, size_t size); // "exit(0)" usw.
+void statuslist_print_and_cleanup(int verbose); // Commande status (-v: mit Ressourcen)
+int statuslist_set_retention(int capacity);    // Pltze fr beendete Jobs (status -r), -1 bei < 1
+int statuslist_retention();                    // aktuelle Anzahl Pltze
+unsigned long statuslist_evicted();            // verdrngte beendete Jobs insgesamt
 void statuslist_free();                        // gibt die liste frei
 
 
@@ -0,0 +1,113 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "strpool.h"
+
+#define STRPOOL_INITIAL_BUCKETS 64
+
+typedef struct PoolEntry {
+    struct PoolEntry *next; // nächster Eintrag im selben Bucket
+    size_t hash;
+    unsigned int refs;
+    char str[];             // die Zeichenkette selbst, ein malloc pro Eintrag
+} PoolEntry;
+
+static PoolEntry **buckets = NULL;
+static size_t bucket_count = 0;
+static size_t entry_count = 0;
+
+/* FNV-1a */
+static size_t hash_str(const char *str) {
+    size_t h = 2166136261u;
+    while (*str) {
+        h ^= (unsigned char)*str++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void *xcalloc(size_t count, size_t size) {
+    void *p = calloc(count, size);
+    if (p == NULL) {
+        perror("strpool");
+        exit(1);
+    }
+    return p;
+}
+
+/* Verdoppelt die Bucket-Anzahl, sobald im Schnitt mehr als ein Eintrag pro Bucket liegt */
+static void grow() {
+    size_t new_count = bucket_count == 0 ? STRPOOL_INITIAL_BUCKETS : bucket_count * 2;
+    PoolEntry **new_buckets = xcalloc(new_count, sizeof(PoolEntry *));
+
+    for (size_t b = 0; b < bucket_count; b++) {
+        PoolEntry *e = buckets[b];
+        while (e != NULL) {
+            PoolEntry *next = e->next;
+            size_t i = e->hash & (new_count - 1);
+            e->next = new_buckets[i];
+            new_buckets[i] = e;
+            e = next;
+        }
+    }
+    free(buckets);
+    buckets = new_buckets;
+    bucket_count = new_count;
+}
+
+const char * strpool_intern(const char *str) {
+    size_t hash = hash_str(str);
+    size_t len;
+    PoolEntry *e;
+
+    if (bucket_count > 0) {
+        for (e = buckets[hash & (bucket_count - 1)]; e != NULL; e = e->next) {
+            if (e->hash == hash && strcmp(e->str, str) == 0) {
+                e->refs++;
+                return e->str;
+            }
+        }
+    }
+
+    if (entry_count >= bucket_count) {
+        grow();
+    }
+    len = strlen(str);
+    e = malloc(sizeof(PoolEntry) + len + 1);
+    if (e == NULL) {
+        perror("strpool");
+        exit(1);
+    }
+    memcpy(e->str, str, len + 1);
+    e->hash = hash;
+    e->refs = 1;
+    e->next = buckets[hash & (bucket_count - 1)];
+    buckets[hash & (bucket_count - 1)] = e;
+    entry_count++;
+    return e->str;
+}
+
+void strpool_release(const char *str) {
+    if (str == NULL) {
+        return;
+    }
+    // str zeigt in einen PoolEntry, daraus den Eintrag zurückrechnen
+    PoolEntry *entry = (PoolEntry *)(str - offsetof(PoolEntry, str));
+    if (--entry->refs > 0) {
+        return;
+    }
+
+    PoolEntry **link = &buckets[entry->hash & (bucket_count - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    free(entry);
+    entry_count--;
+}
+
+size_t strpool_count() {
+    return entry_count;
+}
@@ -0,0 +1,24 @@
+/*
+ * strpool.h
+ *
+ * Zeichenketten-Pool mit Referenzzählern. Gleiche Befehlsnamen (z. B. tausendmal
+ * "sleep" in der Jobtabelle) liegen nur einmal im Speicher; der Eintrag wird
+ * freigegeben, sobald die letzte Referenz zurückgegeben wurde.
+ *
+ */
+
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+#include <stddef.h>
+
+/* Liefert die Kopie von <str> aus dem Pool und erhöht ihren Referenzzähler */
+const char * strpool_intern(const char *str);
+
+/* Gibt eine Referenz von strpool_intern() zurück (NULL ist erlaubt) */
+void strpool_release(const char *str);
+
+/* Anzahl verschiedener Zeichenketten im Pool */
+size_t strpool_count();
+
+#endif /* STRPOOL_H */
@@ -0,0 +1,364 @@
+/*
+ * tokenlexer.c
+ *
+ * Hand-written replacement for the flex scanner in tokenscanner.l (build option
+ * BSHELL_SIMD_LEXER in CMake, LEXER=simd for make). It produces exactly the same
+ * tokens for tokenparser.y:
+ *
+ *   [ \t]+                      skipped
+ *   \n ; < > & | ( )            returned as the character itself
+ *   || && >> << <<<             OR, AND, APPEND, HEREDOC, HERESTRING
+ *   <( >(                       PROCSUB_IN, PROCSUB_OUT
+ *   if then elif else fi        IF, THEN, ELIF, ELSE, FI (only in command position,
+ *   while do done               WHILE, DO, DONE   see starts_command())
+ *   \"[^"]+\"                   STRING (without the quotes, flagged TOKEN_QUOTED)
+ *   word class                  STRING
+ *   any other character         UNDEF
+ *
+ * The end of a word is searched 16 (SSE2) or 32 (AVX2) bytes at a time,
+ * with a scalar table lookup as fallback and for the tail.
+ *
+ * Tokens are not copied: yylval.span points into lex_buf, relative to the start
+ * of the current line, which is kept in the buffer until the next line begins.
+ * The parser decides where a line ends (yy_line_done()): an if or while may
+ * continue over several input lines, which then all count as one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "command.h"
+#include "tokenparser.h"
+#include "readlineparsing.h"
+#include "debug.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define LEXER_INITIAL_SIZE 16384
+
+static char *lex_buf = NULL;
+static size_t lex_cap = 0;
+static size_t lex_pos = 0;   /* next unread byte */
+static size_t lex_len = 0;   /* bytes available in lex_buf */
+static int lex_eof = 0;
+static size_t line_start = 0;  /* first byte of the current line, kept on refill */
+static int line_done = 0;      /* set by the parser, the next token starts a new line */
+static int command_start = 1;  /* the next word is in command position (reserved words) */
+
+/* [A-Za-z0-9/_.\-+*#^,:~$%@?=!\[\]] as a lookup table for the scalar path */
+static unsigned char word_class[256];
+static int word_class_ready = 0;
+
+static void init_word_class() {
+    const char *extra = "/_.-+*#^,:~$%@?=![]";
+    for (int c = 'A'; c <= 'Z'; c++) word_class[c] = 1;
+    for (int c = 'a'; c <= 'z'; c++) word_class[c] = 1;
+    for (int c = '0'; c <= '9'; c++) word_class[c] = 1;
+    for (const char *p = extra; *p; p++) word_class[(unsigned char)*p] = 1;
+    word_class_ready = 1;
+}
+
+/*
+ * The word class is the union of these byte ranges, which lets the SIMD path
+ * test it with a few unsigned range compares:
+ * ! #-% *-: = ?-[ ]-_ a-z ~
+ */
+#if defined(__AVX2__) || defined(__SSE2__)
+static const unsigned char word_ranges[][2] = {
+    { 0x21, 0x21 }, { 0x23, 0x25 }, { 0x2A, 0x3A }, { 0x3D, 0x3D },
+    { 0x3F, 0x5B }, { 0x5D, 0x5F }, { 0x61, 0x7A }, { 0x7E, 0x7E },
+};
+#define WORD_RANGE_COUNT (sizeof(word_ranges) / sizeof(word_ranges[0]))
+#endif
+
+#if defined(__AVX2__)
+static size_t word_span_simd(const unsigned char *p, size_t n, size_t i) {
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i in_class = _mm256_setzero_si256();
+        for (size_t r = 0; r < WORD_RANGE_COUNT; r++) {
+            __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8((char)word_ranges[r][0]));
+            __m256i span = _mm256_set1_epi8((char)(word_ranges[r][1] - word_ranges[r][0]));
+            in_class = _mm256_or_si256(in_class, _mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d));
+        }
+        unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(in_class);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i;
+}
+#elif defined(__SSE2__)
+static size_t word_span_simd(const unsigned char *p, size_t n, size_t i) {
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i in_class = _mm_setzero_si128();
+        for (size_t r = 0; r < WORD_RANGE_COUNT; r++) {
+            __m128i d = _mm_sub_epi8(x, _mm_set1_epi8((char)word_ranges[r][0]));
+            __m128i span = _mm_set1_epi8((char)(word_ranges[r][1] - word_ranges[r][0]));
+            in_class = _mm_or_si128(in_class, _mm_cmpeq_epi8(_mm_min_epu8(d, span), d));
+        }
+        unsigned int mask = ~(unsigned int)_mm_movemask_epi8(in_class) & 0xFFFF;
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i;
+}
+#else
+static size_t word_span_simd(const unsigned char *p, size_t n, size_t i) {
+    return i;
+}
+#endif
+
+/* number of word characters in p[i..n), starting the search at offset i */
+static size_t word_span(const unsigned char *p, size_t n, size_t i) {
+    i = word_span_simd(p, n, i);
+    while (i < n && word_class[p[i]]) {
+        i++;
+    }
+    return i;
+}
+
+/*
+ * Reads more input behind the unread part of the buffer. The current line is moved
+ * to the front first, so offsets relative to lex_pos and line_start stay valid.
+ * Returns the number of new bytes (0 at EOF).
+ */
+static size_t refill() {
+    int n;
+    if (lex_eof) {
+        return 0;
+    }
+    if (line_start > 0) {
+        memmove(lex_buf, lex_buf + line_start, lex_len - line_start);
+        lex_len -= line_start;
+        lex_pos -= line_start;
+        line_start = 0;
+    }
+    if (lex_cap - lex_len < LEXER_INITIAL_SIZE / 2) {
+        lex_cap = lex_cap == 0 ? LEXER_INITIAL_SIZE : lex_cap * 2;
+        lex_buf = realloc(lex_buf, lex_cap);
+    }
+    n = yy_input(lex_buf + lex_len, lex_cap - lex_len);
+    if (n <= 0) {
+        lex_eof = 1;
+        return 0;
+    }
+    lex_len += n;
+    return n;
+}
+
+/* makes sure that at least <count> unread bytes are available, returns 0 if EOF comes first */
+static int ensure(size_t count) {
+    while (lex_len - lex_pos < count) {
+        if (refill() == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* token at lex_buf[start], <len> bytes, as a span relative to the current line */
+static token_span_t span(size_t start, size_t len, int flags) {
+    token_span_t s = { (int)(start - line_start), (int)len, flags };
+    return s;
+}
+
+/*
+ * IF ... DONE for a reserved word, 0 for any other word. Every command name
+ * passes here, so the length decides first and the compares have a constant size.
+ */
+static int keyword(const char *text, size_t len) {
+    switch (len) {
+        case 2:
+            if (memcmp(text, "if", 2) == 0) return IF;
+            if (memcmp(text, "fi", 2) == 0) return FI;
+            if (memcmp(text, "do", 2) == 0) return DO;
+            return 0;
+        case 4:
+            if (memcmp(text, "then", 4) == 0) return THEN;
+            if (memcmp(text, "else", 4) == 0) return ELSE;
+            if (memcmp(text, "elif", 4) == 0) return ELIF;
+            if (memcmp(text, "done", 4) == 0) return DONE;
+            return 0;
+        case 5:
+            return memcmp(text, "while", 5) == 0 ? WHILE : 0;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Reserved words are only recognized where a command may begin: "if true" opens a
+ * conditional, "echo if" passes the word on. A command begins after these tokens.
+ */
+static int starts_command(int token) {
+    switch (token) {
+        case '\n': case ';': case '|': case '&': case '(':
+        case AND: case OR: case PROCSUB_IN: case PROCSUB_OUT:
+        case IF: case THEN: case ELIF: case ELSE: case WHILE: case DO:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Two-character operators (||, &&, >>) or the single character itself */
+static int operator(int c, int twin) {
+    if (ensure(2) && lex_buf[lex_pos + 1] == c) {
+        lex_pos += 2;
+        return twin;
+    }
+    lex_pos++;
+    return c;
+}
+
+static int next_token(void) {
+    if (!word_class_ready) {
+        init_word_class();
+    }
+
+    if (line_done) {
+        line_start = lex_pos;
+        line_done = 0;
+    }
+
+    for (;;) {
+        if (!ensure(1)) {
+            return 0;
+        }
+        unsigned char c = lex_buf[lex_pos];
+
+        switch (c) {
+            case ' ':
+            case '\t':
+                lex_pos++;
+                continue;
+            case '\n':
+                lex_pos++;
+                return c;
+            case ';':
+            case '(':
+            case ')':
+                lex_pos++;
+                return c;
+            case '<':
+                if (ensure(2) && lex_buf[lex_pos + 1] == '(') {
+                    lex_pos += 2;
+                    return PROCSUB_IN;
+                }
+                if (ensure(2) && lex_buf[lex_pos + 1] == '<') {
+                    if (ensure(3) && lex_buf[lex_pos + 2] == '<') {
+                        lex_pos += 3;
+                        return HERESTRING;
+                    }
+                    lex_pos += 2;
+                    return HEREDOC;
+                }
+                lex_pos++;
+                return c;
+            case '|':
+                return operator('|', OR);
+            case '&':
+                return operator('&', AND);
+            case '>':
+                if (ensure(2) && lex_buf[lex_pos + 1] == '(') {
+                    lex_pos += 2;
+                    return PROCSUB_OUT;
+                }
+                return operator('>', APPEND);
+            case '"': {
+                /* \"[^"]+\" – may span several input lines (continuation prompt) */
+                size_t searched = 1;
+                char *end;
+                for (;;) {
+                    end = memchr(lex_buf + lex_pos + searched, '"', lex_len - lex_pos - searched);
+                    if (end != NULL) break;
+                    searched = lex_len - lex_pos;
+                    if (refill() == 0) break;
+                }
+                if (end != NULL && end - (lex_buf + lex_pos) > 1) {
+                    size_t len = end - (lex_buf + lex_pos) + 1;
+                    yylval.span = span(lex_pos + 1, len - 2, TOKEN_QUOTED);
+                    lex_pos += len;
+                    return STRING;
+                }
+                /* "" or unterminated: like flex, the quote alone is an undefined character */
+                yylval.ch = c;
+                lex_pos++;
+                return UNDEF;
+            }
+            default:
+                break;
+        }
+
+        if (word_class[c]) {
+            size_t len = 1;
+            int token;
+            for (;;) {
+                len = word_span((const unsigned char *)lex_buf + lex_pos, lex_len - lex_pos, len);
+                if (lex_pos + len < lex_len || refill() == 0) break;
+            }
+            if (command_start && (token = keyword(lex_buf + lex_pos, len)) != 0) {
+                lex_pos += len;
+                return token;
+            }
+            yylval.span = span(lex_pos, len, 0);
+            lex_pos += len;
+            return STRING;
+        }
+
+        yylval.ch = c;
+        lex_pos++;
+        return UNDEF;
+    }
+}
+
+int yylex(void) {
+    int token = next_token();
+    command_start = starts_command(token);
+    return token;
+}
+
+void yy_line_done() {
+    line_done = 1;
+}
+
+long yy_read_line(char **line) {
+    size_t searched = 0;
+    char *nl;
+    long len;
+
+    for (;;) {
+        nl = memchr(lex_buf + lex_pos + searched, '\n', lex_len - lex_pos - searched);
+        if (nl != NULL) break;
+        searched = lex_len - lex_pos;
+        if (refill() == 0) break;
+    }
+    if (nl == NULL && lex_pos == lex_len) {
+        return -1;
+    }
+    *line = lex_buf + lex_pos;
+    len = nl != NULL ? nl - *line : (long)(lex_len - lex_pos);
+    lex_pos += nl != NULL ? len + 1 : len;
+    return len;
+}
+
+char * yy_token_base() {
+    return lex_buf + line_start;
+}
+
+int yy_scanner_pending() {
+    for (size_t i = lex_pos; i < lex_len; i++) {
+        char c = lex_buf[i];
+        if (c != ' ' && c != '\t' && c != '\n') {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -10,15 +10,21 @@
 #include "list.h"
 #include "debug.h"
 #include "helper.h"
+#include "arena.h"
+#include "heredoc.h"
+#include "readlineparsing.h"
 
 #define YYDEBUG 1
+/* The list rules (a | b | c ...) are right recursive, so the parser stack grows
+ * with the number of commands in a line. The default depth of 10000 runs out
+ * at pipelines of about 3000 stages; the stack is grown on demand up to this. */
+#define YYMAXDEPTH 1000000
 /*typedef struct token_string_seq_t{*/
     /*int len;*/
     /*int position;*/
     /*char ** str;*/
 /*} token_string_seq_t;*/
 
-int yy_getc();
 int yylex(void);
 void yyerror (char const *s) {
     fprintf(stderr, "[%s %s %i] ERROR: %s\n", __FILE__, __func__, __LINE__, s);
@@ -33,6 +39,8 @@ Command *cmd;
 %define parse.error verbose
 %union {
     char *str;
+    int ch;
+    token_span_t span;
     Command *cmd;
     token_string_seq_t tokseq;
     SimpleCommand *simple_cmd;
@@ -40,14 +48,19 @@ Command *cmd;
     List *list;
 }
 
-/*     &&  || >>        */
-%token AND OR APPEND IF THEN ELSE FI
-%token <str> STRING UNDEF
-%type <str> StringType
+/*     &&  || >>  <<  <<<      */
+%token AND OR APPEND HEREDOC HERESTRING
+/* reserved words, only in command position (see the scanner) */
+%token IF THEN ELIF ELSE FI WHILE DO DONE
+/*     <(         >(          */
+%token PROCSUB_IN PROCSUB_OUT
+%token <span> STRING
+%token <ch> UNDEF
+%type <span> StringType
 %type <tokseq> TokenStringSequence;
 %type <cmd> Command;
 %type <simple_cmd> SimpleCommand;
-%type <cmd> CommandSequence CommandPipe CommandAnd CommandOr;
+%type <cmd> AndOr Pipeline Compound Body BodyList IfTail;
 %type <redirection> Redirection;
 %type <list> Redirections;
 %left     ';'
@@ -59,167 +72,163 @@ Command *cmd;
  * input, which it is not!
  * It seems this resets ret once per received line.
  */
-Line: {ret=0;} Command '\n' {cmd = $2; return ret;}
+/* The here-document bodies follow the line, so they are read once its '\n' is seen.
+ * The actions run before the parser asks for another token, so the scanner only
+ * starts the next line (yy_line_done()) after the whole command, even if an if or
+ * while spans several input lines.
+ */
+Line: {ret=0;} Command '\n' {heredoc_read_bodies(); yy_line_done(); cmd = $2; return ret;}
     //| Command {cmd = $1; return ret;}
-    | /* empty */ '\n' {cmd=command_new_empty(); return ret;}
-    | /* EOF */ { fprintf(stdout, "\n"); exit(1);}
+    | /* empty */ '\n' {yy_line_done(); cmd=command_new_empty(); return ret;}
+    | /* EOF */ { shell_exit_on_eof(); }
 ;
 
-Command: SimpleCommand {$$=command_new(C_SIMPLE, $1, NULL);}
-       | CommandSequence {$$=$1;}
-       | CommandOr {$$=$1;}
-       | CommandAnd {$$=$1;}
-       | CommandPipe {$$=$1;}
+/* Precedence from weak to strong: ';', then '&&' and '||' (equal, left to
+ * right), then '|'. The left recursive rules build the tree left associative:
+ * "a && b || c" is OR(AND(a, b), c). Pipelines stay a flat list of stages.
+ */
+Command: AndOr {$$=$1;}
+       | Command ';' AndOr {$$= command_binary(C_SEQUENCE, $1, $3);}
        ;
 
-CommandSequence: SimpleCommand ';' SimpleCommand {$$= command_new(C_SEQUENCE, $1, $3);}
-               | SimpleCommand ';' CommandSequence {$$= command_append(C_SEQUENCE, $1, $3);}
+AndOr: Pipeline {$$=$1;}
+     | AndOr AND Pipeline {$$= command_binary(C_AND, $1, $3);}
+     | AndOr OR Pipeline {$$= command_binary(C_OR, $1, $3);}
+     ;
+
+Pipeline: SimpleCommand {$$=command_new(C_SIMPLE, $1, NULL);}
+        | SimpleCommand '|' Pipeline {
+                  if ($3->command_type != C_SIMPLE && $3->command_type != C_PIPE) {
+                      fprintf(stderr, "a compound command cannot be a stage of a pipeline\n");
+                      ret=2;
+                      $$=$3;
+                  } else {
+                      $$= command_append(C_PIPE, $1, $3);
+                  }
+          }
+        | Compound {$$=$1;}
+        | Compound '|' Pipeline {
+                  fprintf(stderr, "a compound command cannot be a stage of a pipeline\n");
+                  ret=2;
+                  $$=$1;
+          }
+        ;
+
+/* Redirections of a compound command apply to the whole command: ( ... ) > file,
+ * while ...; done < file. if and while run in the shell itself, ( ... ) runs in a
+ * child, so "(cd /)" or "(exit 3)" do not change the shell.
+ */
+Compound: '(' Command ')' Redirections {$$= command_subshell($2, $4);}
+        | IF Body THEN Body IfTail Redirections {
+                  $$= command_if($2, $4, $5);
+                  if ($6 != NULL) $$= command_group($$, $6);
+          }
+        | WHILE Body DO Body DONE Redirections {
+                  $$= command_while($2, $4);
+                  if ($6 != NULL) $$= command_group($$, $6);
+          }
+        ;
+
+/* the else part: NULL, a Body, or for elif another C_IF */
+IfTail: FI {$$=NULL;}
+      | ELSE Body FI {$$=$2;}
+      | ELIF Body THEN Body IfTail {$$= command_if($2, $4, $5);}
+      ;
+
+/* The commands between the reserved words: each one ends with ';' or a newline,
+ * empty lines are allowed ("while true; do\n  ls\ndone").
+ */
+Body: Linebreak BodyList {$$=$2;}
+    ;
 
-CommandPipe: SimpleCommand '|' SimpleCommand {$$= command_new(C_PIPE, $1, $3);}
-               | SimpleCommand '|' CommandPipe {$$= command_append(C_PIPE, $1, $3);}
+BodyList: AndOr Separator {$$=$1;}
+        | BodyList AndOr Separator {$$= command_binary(C_SEQUENCE, $1, $2);}
+        ;
 
-CommandAnd: SimpleCommand AND SimpleCommand {$$= command_new(C_AND, $1, $3);}
-               | SimpleCommand AND CommandAnd {$$= command_append(C_AND, $1, $3);}
+Separator: ';' Linebreak
+         | Newline Linebreak
+         ;
 
-CommandOr: SimpleCommand OR SimpleCommand {$$= command_new(C_OR, $1, $3);}
-               | SimpleCommand OR CommandOr {$$= command_append(C_OR, $1, $3);}
+Linebreak: /* empty */
+         | Linebreak Newline
+         ;
 
+/* here-documents of the line before are read here, as at the end of a Line */
+Newline: '\n' {heredoc_read_bodies();}
+       ;
 
 Redirections: /* empty */ {$$=NULL;}
-            | Redirection Redirections { $$=list_append($1, $2);}
+            | Redirection Redirections { $$=list_append_arena(&parse_arena, $1, $2);}
 
 Redirection: '>' TokenStringSequence {
-                        $$=malloc(sizeof(Redirection));
+                        $$=arena_alloc(&parse_arena, sizeof(Redirection));
                         $$->r_type=R_FILE;
                         $$->r_mode=M_WRITE;
-                        $$->u.r_file=$2.str[0];
-                        /* no longer nedded */
-                        free($2.str);
-
+                        $$->u.r_file=NULL;
+                        $$->r_span=$2.spans[0];
            }
            | '<' TokenStringSequence {
-                        $$=malloc(sizeof(Redirection));
+                        $$=arena_alloc(&parse_arena, sizeof(Redirection));
                         $$->r_type=R_FILE;
                         $$->r_mode=M_READ;
-                        $$->u.r_file=$2.str[0];
-                        /* no longer nedded */
-                        free($2.str);
+                        $$->u.r_file=NULL;
+                        $$->r_span=$2.spans[0];
            }
            | APPEND TokenStringSequence {
-                        $$=malloc(sizeof(Redirection));
+                        $$=arena_alloc(&parse_arena, sizeof(Redirection));
                         $$->r_type=R_FILE;
                         $$->r_mode=M_APPEND;
-                        $$->u.r_file=$2.str[0];
-                        /* no longer nedded */
-                        free($2.str);
+                        $$->u.r_file=NULL;
+                        $$->r_span=$2.spans[0];
+           }
+           | HEREDOC TokenStringSequence {
+                        /* the body is read by heredoc_read_bodies() after the line */
+                        $$=heredoc_redirection($2.spans[0], 0);
+           }
+           | HERESTRING TokenStringSequence {
+                        $$=heredoc_redirection($2.spans[0], 1);
            }
 
 SimpleCommand: TokenStringSequence Redirections { 
-             $$ = simple_command_new($1.len, $1.str, $2, 0); 
+             $$ = simple_command_new($1.len, $1.spans, $2, 0); 
              }
              | TokenStringSequence Redirections '&' { 
-             $$ = simple_command_new($1.len, $1.str, $2, 1); 
+             $$ = simple_command_new($1.len, $1.spans, $2, 1); 
              }
 ;
                
 TokenStringSequence: StringType {
-                   /* NOTE: This function tries to use a fully dynamic memory allocation approach
-                    * to support unlimited numbers of tokens.
-                    * A much easier approach is to limit the tokens to a specific number.
-                    * In this case, all that needs to be done is:
-                    * $$.str=calloc(1024,sizeof(char *));
-                    * for 1024 possible command line arguments!
+                   /* NOTE: The container lives in parse_arena, which is reset after every
+                    * line. The tokens are only spans into the input line; argv (with the
+                    * NULL for execve) is built by command_materialize() after parsing.
                     */
                    $$.len=1;
-                   /* We allocate 8 bytes more "container space"-memory than necessary, because
-                    * we need initialized memory here after the last argv*, 
-                    * if not valgrind complains that argv points to uninitialized memory.
-                    * Note: $$.str is char **, so this is only the array $$.str[here][] container 
-                    * for the tokens 
-                    */
-                   $$.str=calloc(2,sizeof(char *));
-                   
-                   /* this is the actual token string that is used $$.str[0][here] */
-                   /* now we have: 
-                    * $$.str[0][here]="A TOKEN STRING"
-                    */
-                   $$.str[0]=$1;
-
-                   /* we do not need to allocate new memory and use strcpy.
-                    * the string is already alocated and available from the scanner!
-                    * strcpy($$.str[0], $1);
-                    * calloc(strlen($1)+1, sizeof(char));
-                    */
-                   
-                   //hexDump("HEXDUMP OF ALLOCATE $$", $$.str, 32, 0);
-                   //hexDump("HEXDUMP OF ALLOCATE STRING", $$.str[0], strlen($$.str[0]) , 0);
+                   $$.cap=4;
+                   $$.spans=arena_alloc(&parse_arena, $$.cap*sizeof(token_span_t));
+                   $$.spans[0]=$1;
                    }
                    | TokenStringSequence StringType {
-                   char * tmp = NULL;
-                   
-                   /* Remember: We allocate 8 bytes more initialized (ZERO) memory than necessary!
-                    * It makes also sense to allocate initially a fixed number of Bytes and keep
-                    * track of used and free memory. Actually, this is what the original implementation
-                    * did. But in this case, we need an additional managed memory area, that keeps track
-                    * of used and free memory. (This was the original wortspeicher, which used realloc
-                    * and was explicitly managing this memory)
-                    */
-                   
-                   /* NOTE: In a static version, all that must be done is
-                    * $$.str[$$.len]=$2
-                    */
-                   
-
-                   /* NOTE: Intead of copying the strings around, realloc could have been used instead.
-                    * But, the problem in this case is that execve expects initialized memory and, as such,
-                    * it would have been necessray to initialize the reallocated memory manually to '\0'.
-                    * By using calloc, we get the initilization for free, but need the copy mechanism.
-                    */
-                   /* The idea is the following:
-                    * 1. Copy the current container ( holding the string pointers) to a temporary container
-                    * 2. Create a new container for one more item
-                    * 3. Copy the original container to the new container(on head position)
-                    * 4. allocate memory for the new token and insert it into the enlarged container
+                   /* The container grows geometrically, so n tokens cost O(n) copies.
+                    * The old container is simply left behind in the arena.
                     */
-
-
-                   /* 1.*/
-                   /* copy original old stringpointer */
-                   tmp = calloc($$.len+1, sizeof(char *)); /* current container size + 1 */
-                   memcpy(tmp, $$.str, (1+$$.len)* sizeof(char *));
-                   /* contents of $$.str has been copied to tmp and will be copied back to
-                    * the head position of the new enlarged $$.str container 
-                    * Since it no longer required, we free it now.
-                    */ 
-                   free($$.str); /* aka the memory for the "old" string */
-                   
-                   /* 2. */
-                   /* make a bigger array $$.str[here++][] and copy values back (c.f. execve requirement)*/
-                   $$.str=calloc(2+$$.len,sizeof(char *));
-
-                   /* 3. */
-                   /* now we simply copy back the old string/strings to the new memory area*/
-                   memcpy($$.str, tmp, (1+$$.len) * sizeof(char *));
-                   /* tmp can be freed now, we do not need it anymore */
-                   free(tmp);
-
-                   /* 4. */
-                   /* now we allocate another memory slot for the new token */
-                   $$.str[$$.len]=$2; 
-                   /* we do not need to allocate new memory and use strcpy.
-                    * the string is already alocated and available from the scanner!
-                    * calloc(strlen($2)+1, sizeof(char));
-                    * strcpy($$.str[$$.len], $2);
-                    */
-/* and finally copy the contents from the parser */
-                   //hexDump("HEXDUMP OF ALLOCATE $$", $$.str, 32, 0);
-                   //hexDump("HEXDUMP OF ALLOCATE STRING", $$.str[$$.len], strlen($$.str[$$.len]), 0);
-                   $$.len++; 
-                   } 
+                   if ($$.len == $$.cap) {
+                       token_span_t * bigger = arena_alloc(&parse_arena, 2*$$.cap*sizeof(token_span_t));
+                       memcpy(bigger, $$.spans, $$.len * sizeof(token_span_t));
+                       $$.spans = bigger;
+                       $$.cap *= 2;
+                   }
+                   $$.spans[$$.len]=$2;
+                   $$.len++;
+                   }
            ;
 StringType: STRING { $$=$1;}
-          | UNDEF  { fprintf(stderr, "undefined character \'%c\' (=0x%0x)\n", $1[0], $1[0]);
-                    $$=$1;
+          /* the word becomes /dev/fd/N when the command runs, see execute.c */
+          | PROCSUB_IN Command ')' { $$=command_procsub($2, 0);}
+          | PROCSUB_OUT Command ')' { $$=command_procsub($2, 1);}
+          | UNDEF  { fprintf(stderr, "undefined character \'%c\' (=0x%0x)\n", $1, $1);
+                    $$.offset=0;
+                    $$.len=0;
+                    $$.flags=0;
                     /* this ret prevent the execution of a command when a an invalid char 
                      * is found. This is handled in shell.c in variable parser_res!
                      */
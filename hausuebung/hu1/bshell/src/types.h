@@ -1,7 +1,27 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+/*
+ * A token is a view into the current input line (see yy_token_base()), with
+ * the quotes of a quoted string already removed. The hand-written lexer
+ * (tokenlexer.c) points into its input buffer, so tokens are not copied at
+ * all; the flex scanner copies each token once into its own line buffer,
+ * because flex drops consumed input on refill.
+ */
+#define TOKEN_QUOTED 1   /* the token was written as "..." */
+#define TOKEN_PROCSUB 2  /* <(...) or >(...): offset indexes the line's process substitutions */
+
+typedef struct token_span_t{
+    int offset;   /* relative to yy_token_base() */
+    int len;
+    int flags;    /* TOKEN_QUOTED, TOKEN_PROCSUB */
+} token_span_t;
+
 typedef struct token_string_seq_t{
     int len;
     int position;
-    char ** str;
+    int cap;      /* slots in spans */
+    token_span_t * spans;
 } token_string_seq_t;
 
-
+#endif /* end of include guard: TYPES_H */
@@ -0,0 +1,411 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "xargs.h"
+#include "command.h"
+#include "launcher.h"
+#include "statuslist.h"
+#include "eventloop.h"
+#include "shell.h"
+#include "debug.h"
+
+#define XARGS_READ_CHUNK 65536
+#define XARGS_HEADROOM 2048      // Reserve unter ARG_MAX wie bei GNU xargs
+#define XARGS_MAX_WORKERS 1024
+
+extern char **environ;
+extern int fdtty;
+extern int shell_pid;
+
+typedef struct {
+    int nul;              // -0: Elemente durch '\0' getrennt statt durch Leerraum
+    long max_items;       // -n: höchstens so viele Elemente pro Aufruf (0 = nur ARG_MAX)
+    int workers;          // -P: gleichzeitige Prozesse
+    long max_bytes;       // -s: Obergrenze für argv (0 = ARG_MAX)
+    int stats;            // -v: Statistik auf stderr
+    const char *file;     // -a: Elemente aus Datei statt stdin
+    char **command;       // Befehl und feste Argumente
+    int command_count;
+} XargsOptions;
+
+/*
+ * Ein Stapel wird direkt im Format von SimpleCommand gebaut (command_tokens,
+ * command_spans), damit die Startschicht ihn wie einen geparsten Befehl
+ * behandelt. Die Elemente zeigen in den Lesepuffer.
+ */
+typedef struct {
+    char **tokens;
+    token_span_t *spans;
+    int count;
+    int cap;
+    size_t bytes;         // argv-Größe inklusive Zeiger, wie sie execve zählt
+} Batch;
+
+/* Laufende Prozesse */
+typedef struct {
+    pid_t *pids;
+    int *statuses;
+    int count;
+    int max;
+    int result;           // Exit-Status von xargs
+    pid_t fg;             // interaktiv: Vordergrundgruppe beim Start (die Pipe oder die Shell)
+} Workers;
+
+static int is_separator(const XargsOptions *opts, char c) {
+    if (opts->nul)
+        return c == '\0';
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+static size_t environ_bytes() {
+    size_t total = sizeof(char *);
+    for (char **env = environ; *env != NULL; env++) {
+        total += strlen(*env) + 1 + sizeof(char *);
+    }
+    return total;
+}
+
+static int parse_long(const char *opt, const char *arg, long min, long max, long *out) {
+    char *end;
+    long n;
+
+    if (arg == NULL) {
+        fprintf(stderr, "xargs: %s: argument expected\n", opt);
+        return -1;
+    }
+    n = strtol(arg, &end, 10);
+    if (*end != '\0' || n < min || n > max) {
+        fprintf(stderr, "xargs: %s %s: invalid number\n", opt, arg);
+        return -1;
+    }
+    *out = n;
+    return 0;
+}
+
+static int parse_options(char **argv, XargsOptions *opts) {
+    static char *default_command[] = { "echo", NULL };
+    int i;
+    long n;
+
+    memset(opts, 0, sizeof(*opts));
+    opts->workers = 1;
+    for (i = 1; argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        } else if (strcmp(argv[i], "-0") == 0) {
+            opts->nul = 1;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            opts->stats = 1;
+        } else if (strcmp(argv[i], "-a") == 0) {
+            if ((opts->file = argv[++i]) == NULL) {
+                fprintf(stderr, "xargs: -a: argument expected\n");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "-n") == 0) {
+            if (parse_long("-n", argv[++i], 1, 1L << 30, &opts->max_items) < 0)
+                return -1;
+        } else if (strcmp(argv[i], "-P") == 0) {
+            if (parse_long("-P", argv[++i], 1, XARGS_MAX_WORKERS, &n) < 0)
+                return -1;
+            opts->workers = (int)n;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            if (parse_long("-s", argv[++i], 1, 1L << 30, &opts->max_bytes) < 0)
+                return -1;
+        } else {
+            fprintf(stderr, "xargs: usage: xargs [-0] [-a file] [-n max] [-P n] [-s bytes] [-v] [command [args...]]\n");
+            return -1;
+        }
+    }
+    opts->command = argv[i] != NULL ? &argv[i] : default_command;
+    for (opts->command_count = 0; opts->command[opts->command_count] != NULL; opts->command_count++)
+        ;
+    return 0;
+}
+
+static void batch_push(Batch *batch, char *token, int len) {
+    if (batch->count + 1 >= batch->cap) {   // Platz für das NULL am Ende lassen
+        batch->cap = batch->cap == 0 ? 256 : batch->cap * 2;
+        batch->tokens = realloc(batch->tokens, batch->cap * sizeof(char *));
+        batch->spans = realloc(batch->spans, batch->cap * sizeof(token_span_t));
+        if (batch->tokens == NULL || batch->spans == NULL) {
+            perror("xargs");
+            exit(1);
+        }
+    }
+    batch->tokens[batch->count] = token;
+    batch->spans[batch->count].offset = 0;
+    batch->spans[batch->count].len = len;
+    batch->spans[batch->count].flags = 0;
+    batch->count++;
+    batch->bytes += len + 1 + sizeof(char *);
+}
+
+/* Leert den Stapel bis auf Befehl und feste Argumente */
+static void batch_reset(Batch *batch, const XargsOptions *opts) {
+    batch->count = 0;
+    batch->bytes = sizeof(char *);   // NULL am Ende von argv
+    for (int i = 0; i < opts->command_count; i++) {
+        batch_push(batch, opts->command[i], strlen(opts->command[i]));
+    }
+}
+
+/* Exit-Status von xargs aus dem Status eines Aufrufs (wie GNU xargs) */
+static void workers_collect(Workers *w, int status) {
+    int res = 0;
+
+    if (WIFSIGNALED(status))
+        res = 125;
+    else if (WEXITSTATUS(status) == 255)
+        res = 124;
+    else if (WEXITSTATUS(status) != 0)
+        res = 123;
+    if (res > w->result)
+        w->result = res;
+}
+
+/* Wartet, bis weniger als <limit> Prozesse laufen */
+static void workers_wait(Workers *w, int limit) {
+    while (w->count >= limit && w->count > 0) {
+        for (int i = 0; i < w->count; i++) {
+            w->statuses[i] = -1;
+        }
+        eventloop_wait_any(w->pids, w->count, w->statuses);
+
+        int kept = 0;
+        for (int i = 0; i < w->count; i++) {
+            if (w->statuses[i] == -1) {
+                w->pids[kept++] = w->pids[i];
+            } else {
+                workers_collect(w, w->statuses[i]);
+            }
+        }
+        if (kept == w->count) {
+            break;   // keine Kinder mehr (sollte nicht passieren)
+        }
+        w->count = kept;
+    }
+}
+
+/*
+ * Startet den Stapel, sobald ein Platz frei ist. Rückgabe: 0 oder der negative
+ * Status, wenn der Befehl nicht startet (-127 nicht gefunden, siehe spawn_simple_command()),
+ * -125 wenn ein Aufruf durch ein Signal (z. B. Ctrl-C) endete: dann wie GNU xargs aufhören
+ */
+static int batch_launch(Batch *batch, Workers *w, int dev_null) {
+    SimpleCommand cmd_s;
+    SpawnOptions spawn = { .fd_in = dev_null, .fd_out = -1, .pgid = 0 };
+    pid_t pid;
+
+    workers_wait(w, w->max);
+    if (w->result == 125)
+        return -125;
+
+    batch->tokens[batch->count] = NULL;
+    memset(&cmd_s, 0, sizeof(cmd_s));
+    cmd_s.command_tokens = batch->tokens;
+    cmd_s.command_spans = batch->spans;
+    cmd_s.command_token_counter = batch->count;
+
+    // Ohne Jobkontrolle in der Gruppe der Shell. Interaktiv in der Gruppe der Pipe,
+    // an deren Ende xargs läuft: sie hat das Terminal, Ctrl-C erreicht also auch die
+    // Aufrufe. Läuft xargs allein (Vordergrund ist die Shell) oder ist die Gruppe schon
+    // leer, bekommen die Aufrufe eine eigene Gruppe und das Terminal wie bei execute_fork()
+    if (!shell_interactive)
+        spawn.pgid = getpgrp();
+    else if (w->fg > 0 && w->fg != shell_pid && kill(-w->fg, 0) == 0)
+        spawn.pgid = w->fg;
+    else if (w->count > 0)
+        spawn.pgid = getpgid(w->pids[0]);
+    pid = spawn_simple_command(&cmd_s, &spawn);
+    if (pid < 0) {
+        return pid;
+    }
+    if (shell_interactive && spawn.pgid == 0)
+        tcsetpgrp(fdtty, pid);
+    statuslist_add(pid, spawn.pgid != 0 ? spawn.pgid : pid, batch->tokens[0]);
+    w->pids[w->count++] = pid;
+    return 0;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int builtin_xargs(char **argv) {
+    XargsOptions opts;
+    Batch batch = { 0 };
+    Workers w = { 0 };
+    struct timespec start;
+    char *buf = NULL;
+    size_t len = 0, cap = 0;
+    size_t scan = 0;         // Anfang des noch nicht zerlegten Teils von buf
+    size_t batch_start = 0;  // erstes Element des aktuellen Stapels in buf
+    long arg_max = sysconf(_SC_ARG_MAX);
+    long max_strlen = 32 * sysconf(_SC_PAGESIZE);
+    size_t budget;
+    size_t base_bytes;       // argv-Größe nur mit Befehl und festen Argumenten
+    unsigned long items = 0, batches = 0;
+    int fd = STDIN_FILENO;
+    int dev_null;
+    int eof = 0;
+    int failed = 0;
+
+    if (parse_options(argv, &opts) < 0) {
+        return 1;
+    }
+    if (opts.file != NULL && (fd = open(opts.file, O_RDONLY | O_CLOEXEC)) < 0) {
+        fprintf(stderr, "xargs: %s: %s\n", opts.file, strerror(errno));
+        return 1;
+    }
+    // Die Aufrufe lesen nicht die Elemente mit (wie bei GNU xargs)
+    dev_null = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    budget = arg_max > 0 ? (size_t)arg_max : 131072;
+    budget = budget > environ_bytes() + XARGS_HEADROOM ? budget - environ_bytes() - XARGS_HEADROOM : 0;
+    if (opts.max_bytes > 0 && (size_t)opts.max_bytes < budget)
+        budget = opts.max_bytes;
+
+    w.max = opts.workers;
+    w.fg = shell_interactive ? tcgetpgrp(fdtty) : 0;
+    w.pids = malloc(w.max * sizeof(pid_t));
+    w.statuses = malloc(w.max * sizeof(int));
+    if (w.pids == NULL || w.statuses == NULL) {
+        perror("xargs");
+        exit(1);
+    }
+    batch_reset(&batch, &opts);
+    base_bytes = batch.bytes;
+    if (base_bytes > budget) {
+        fprintf(stderr, "xargs: command too long\n");
+        failed = 1;
+        eof = 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (!eof && !failed) {
+        // Puffer voll: Bereits gestartete Elemente verwerfen, sonst vergrößern
+        if (len == cap) {
+            size_t keep_from = batch.count > opts.command_count ? batch_start : scan;
+            if (keep_from > 0) {
+                memmove(buf, buf + keep_from, len - keep_from);
+                for (int i = opts.command_count; i < batch.count; i++) {
+                    batch.tokens[i] -= keep_from;
+                }
+                len -= keep_from;
+                scan -= keep_from;
+                batch_start -= keep_from;
+            }
+            if (len == cap) {
+                // Elemente als Abstand merken, realloc darf den Puffer verschieben
+                for (int i = opts.command_count; i < batch.count; i++) {
+                    batch.tokens[i] = (char *)(batch.tokens[i] - buf);
+                }
+                cap = cap == 0 ? XARGS_READ_CHUNK : cap * 2;
+                buf = realloc(buf, cap + 1);
+                if (buf == NULL) {
+                    perror("xargs");
+                    exit(1);
+                }
+                for (int i = opts.command_count; i < batch.count; i++) {
+                    batch.tokens[i] = buf + (size_t)batch.tokens[i];
+                }
+            }
+        }
+
+        ssize_t n = read(fd, buf + len, cap - len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("xargs");
+            failed = 1;
+            break;
+        }
+        if (n == 0) {
+            eof = 1;
+            buf[len] = opts.nul ? '\0' : '\n';   // letztes Element ohne Trenner abschließen (cap + 1)
+            len++;
+        } else {
+            len += n;
+        }
+
+        // Vollständige Elemente (mit Trenner dahinter) in den Stapel übernehmen
+        for (;;) {
+            while (scan < len && is_separator(&opts, buf[scan]))
+                scan++;
+            size_t end = scan;
+            while (end < len && !is_separator(&opts, buf[end]))
+                end++;
+            if (end >= len) {
+                break;   // kein Trenner dahinter, erst weiterlesen
+            }
+
+            size_t item_len = end - scan;
+            size_t cost = item_len + 1 + sizeof(char *);
+            buf[end] = '\0';
+            if ((long)item_len >= max_strlen || base_bytes + cost > budget) {
+                fprintf(stderr, "xargs: argument too long (%zu bytes)\n", item_len);
+                failed = 1;
+                break;
+            }
+            if (batch.count > opts.command_count &&
+                (batch.bytes + cost > budget ||
+                 (opts.max_items > 0 && batch.count - opts.command_count >= opts.max_items))) {
+                int err = batch_launch(&batch, &w, dev_null);
+                if (err < 0) {
+                    failed = -err;
+                    break;
+                }
+                batches++;
+                batch_reset(&batch, &opts);
+            }
+            if (batch.count == opts.command_count)
+                batch_start = scan;
+            batch_push(&batch, buf + scan, item_len);
+            items++;
+            scan = end + 1;
+        }
+    }
+
+    if (!failed && batch.count > opts.command_count) {
+        int err = batch_launch(&batch, &w, dev_null);
+        if (err < 0)
+            failed = -err;
+        else
+            batches++;
+    }
+    workers_wait(&w, 1);
+    // Terminal zurück an die Pipe bzw. die Shell (gibt es die Gruppe nicht mehr, holt es pipe_wait())
+    if (shell_interactive && w.fg > 0 && tcgetpgrp(fdtty) != w.fg)
+        tcsetpgrp(fdtty, w.fg);
+
+    if (opts.stats) {
+        double ms = elapsed_ms(&start);
+        fprintf(stderr, "xargs: %lu items in %lu batches (avg %.1f items/batch, %d workers), %.1f ms, %.0f items/s\n",
+                items, batches, batches > 0 ? (double)items / batches : 0.0, opts.workers, ms,
+                ms > 0 ? items / (ms / 1000.0) : 0.0);
+    }
+
+    if (fd != STDIN_FILENO)
+        close(fd);
+    if (dev_null >= 0)
+        close(dev_null);
+    free(buf);
+    free(batch.tokens);
+    free(batch.spans);
+    free(w.pids);
+    free(w.statuses);
+
+    if (failed)
+        return failed;   // 127/126/125 wie in GNU xargs, sonst 1
+    return w.result;
+}
@@ -0,0 +1,16 @@
+/*
+ * xargs.h
+ *
+ * Builtin "xargs": liest Elemente von stdin (oder -a Datei), packt so viele
+ * in ein argv, wie unter ARG_MAX passen, und startet die Stapel über die
+ * Startschicht der Shell (launcher.c) auf bis zu -P Prozessen gleichzeitig.
+ *
+ */
+
+#ifndef XARGS_H
+#define XARGS_H
+
+/* xargs [-0] [-a DATEI] [-n MAX] [-P N] [-s BYTES] [-v] [befehl [argumente...]] */
+int builtin_xargs(char **argv);
+
+#endif /* XARGS_H */
@@ -0,0 +1,458 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "zerocopy.h"
+#include "debug.h"
+
+#define ZEROCOPY_CHUNK (1 << 20)        // Bytes pro splice/copy_file_range
+#define ZEROCOPY_BUFFER (256 * 1024)    // Puffer für read/write
+
+typedef enum {
+    FD_PIPE,
+    FD_FILE,     // reguläre Datei
+    FD_OTHER     // Terminal, Gerät, Socket, ...
+} FdKind;
+
+static FdKind fd_kind(int fd) {
+    struct stat st;
+
+    if (fstat(fd, &st) < 0)
+        return FD_OTHER;
+    if (S_ISFIFO(st.st_mode))
+        return FD_PIPE;
+    if (S_ISREG(st.st_mode))
+        return FD_FILE;
+    return FD_OTHER;
+}
+
+static int is_append(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && (flags & O_APPEND);
+}
+
+/* Schreibt <len> Bytes vollständig, 0 oder -1 */
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Rückfall: lesen und schreiben über einen großen Puffer */
+static int copy_rw(int in, int out) {
+    char *buf = malloc(ZEROCOPY_BUFFER);
+    int res = 0;
+
+    if (buf == NULL)
+        return -1;
+    for (;;) {
+        ssize_t n = read(in, buf, ZEROCOPY_BUFFER);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            res = n < 0 ? -1 : 0;
+            break;
+        }
+        if (write_all(out, buf, n) < 0) {
+            res = -1;
+            break;
+        }
+    }
+    free(buf);
+    return res;
+}
+
+/*
+ * Liefert 1, wenn der Aufruf mit diesem errno einfach nicht unterstützt wird
+ * (dann geht es mit read/write weiter), 0 bei einem echten Fehler.
+ */
+static int unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP || err == EBADF;
+}
+
+int zerocopy_copy(int in, int out) {
+    FdKind kind_in = fd_kind(in);
+    FdKind kind_out = fd_kind(out);
+    ssize_t n;
+
+    // Datei -> Datei: der Kernel (oder das Dateisystem, z. B. reflink) kopiert selbst.
+    // Ohne Offsets werden die Dateipositionen weitergeschoben, ein Rückfall macht
+    // also genau dort weiter.
+    if (kind_in == FD_FILE && kind_out == FD_FILE && !is_append(out)) {
+        while ((n = copy_file_range(in, NULL, out, NULL, ZEROCOPY_CHUNK, 0)) > 0)
+            ;
+        if (n == 0)
+            return 0;
+        if (!unsupported(errno))
+            return -1;
+    }
+
+    // Eine Seite ist eine Pipe: Seiten werden nur umgehängt (O_APPEND kann splice nicht)
+    if ((kind_in == FD_PIPE || kind_out == FD_PIPE) && !is_append(out)) {
+        for (;;) {
+            n = splice(in, NULL, out, NULL, ZEROCOPY_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+        }
+        if (n == 0)
+            return 0;
+        if (!unsupported(errno))
+            return -1;
+    }
+
+    return copy_rw(in, out);
+}
+
+/* Meldet den Fehler der Ausgabe <i> und lässt sie ab jetzt aus; EPIPE (Leser weg) bleibt still */
+static void drop_output(int *outs, int i, const char **names) {
+    if (errno != EPIPE)
+        fprintf(stderr, "tee: %s: %s\n", names[i], strerror(errno));
+    outs[i] = -1;
+}
+
+/* Anzahl der Ausgaben, die noch funktionieren */
+static int outputs_alive(const int *outs, int nout) {
+    int alive = 0;
+    for (int i = 0; i < nout; i++)
+        alive += outs[i] >= 0;
+    return alive;
+}
+
+/* Öffnet "-" als <fd_in>, sonst die Datei; -1 bei Fehler (Meldung ausgegeben) */
+static int open_input(const char *name, int fd_in) {
+    int fd;
+
+    if (strcmp(name, "-") == 0)
+        return fd_in;
+    fd = open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        fprintf(stderr, "cat: %s: %s\n", name, strerror(errno));
+    return fd;
+}
+
+/*
+ * Überspringt die Optionen ab argv[1], erlaubt sind nur "-X" mit X aus <known>.
+ * Rückgabe: Index des ersten Operanden oder -1 bei einer anderen Option.
+ */
+static int skip_options(char **argv, const char *known) {
+    int i = 1;
+
+    for (; argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--") == 0)
+            return i + 1;
+        if (argv[i][2] != '\0' || strchr(known, argv[i][1]) == NULL)
+            return -1;
+    }
+    return i;
+}
+
+int cat_accepts(char **argv) {
+    return skip_options(argv, "u") >= 0;   // -u (ungepuffert) ist hier ohnehin so
+}
+
+int stage_cat(char **argv, int fd_in, int fd_out) {
+    static char *stdin_only[] = { "-", NULL };
+    char **files;
+    int res = 0;
+    int i = skip_options(argv, "u");
+
+    if (i < 0) {
+        fprintf(stderr, "cat: option not supported by the builtin (use /bin/cat)\n");
+        return 2;
+    }
+    files = argv[i] != NULL ? &argv[i] : stdin_only;
+
+    for (i = 0; files[i] != NULL; i++) {
+        int fd = open_input(files[i], fd_in);
+        if (fd < 0) {
+            res = 1;
+            continue;
+        }
+        int failed = zerocopy_copy(fd, fd_out) < 0;
+        int gone = failed && errno == EPIPE;   // Leser ist weg: still aufhören
+        if (failed && !gone)
+            fprintf(stderr, "cat: %s: %s\n", files[i], strerror(errno));
+        if (fd != fd_in)
+            close(fd);
+        if (failed)
+            res = 1;
+        if (gone)
+            break;
+    }
+    return res;
+}
+
+int builtin_cat(char **argv) {
+    return stage_cat(argv, STDIN_FILENO, STDOUT_FILENO);
+}
+
+/*
+ * tee ohne Kopie in den Benutzerspeicher: jeder Block wandert per splice in eine
+ * Zwischen-Pipe <scratch> und wird von dort per tee(2) in die Ausgabe-Pipes
+ * verdoppelt; Dateien bekommen ihn über eine zweite Pipe <filepipe> per splice.
+ * Die letzte Ausgabe verbraucht den Block per splice. Hat tee(2) bei einer vollen
+ * Ausgabe-Pipe nur einen Teil geschafft, wird der Block gelesen und der Rest
+ * normal geschrieben (tee(2) fängt immer am Anfang der Pipe an).
+ *
+ * <outs> mit -1 sind ausgefallen (Schreibfehler). Rückgabe: 0, 1 (Schreibfehler) oder -1
+ * (Kernel kann es nicht, nichts wurde gelesen).
+ */
+static int tee_splice(int in, int *outs, int nout, const char **names) {
+    int scratch[2], filepipe[2] = { -1, -1 };
+    int *partial = calloc(nout, sizeof(int));
+    char *buf = NULL;
+    int need_filepipe = 0;
+    int res = 0;
+    int cap;
+
+    for (int i = 0; i < nout - 1; i++) {
+        if (fd_kind(outs[i]) == FD_FILE)
+            need_filepipe = 1;
+    }
+    if (partial == NULL || pipe2(scratch, O_CLOEXEC) < 0) {
+        free(partial);
+        return -1;
+    }
+    fcntl(scratch[1], F_SETPIPE_SZ, ZEROCOPY_CHUNK);
+    cap = fcntl(scratch[1], F_GETPIPE_SZ);
+    if (need_filepipe) {
+        // gleiche Größe wie scratch, dann passt ein ganzer Block hinein
+        if (pipe2(filepipe, O_CLOEXEC) < 0 || fcntl(filepipe[1], F_SETPIPE_SZ, cap) < cap) {
+            res = -1;
+            goto out;
+        }
+    }
+
+    for (int first = 1; outputs_alive(outs, nout) > 0; first = 0) {
+        ssize_t n = splice(in, NULL, scratch[1], NULL, cap, SPLICE_F_MOVE);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && first && unsupported(errno)) {
+            res = -1;   // z. B. Terminal als Eingabe: read/write übernimmt
+            break;
+        }
+        if (n <= 0) {
+            if (n < 0) {
+                fprintf(stderr, "tee: read error: %s\n", strerror(errno));
+                res = 1;
+            }
+            break;
+        }
+
+        int any_partial = 0;
+        for (int i = 0; i < nout - 1; i++) {
+            partial[i] = n;
+            if (outs[i] < 0)
+                continue;
+            if (fd_kind(outs[i]) == FD_PIPE) {
+                ssize_t m = tee(scratch[0], outs[i], n, 0);
+                if (m < 0) {
+                    drop_output(outs, i, names);
+                    res = 1;
+                    continue;
+                }
+                partial[i] = m;
+                if (m < n)
+                    any_partial = 1;
+            } else {
+                // filepipe ist leer und so groß wie scratch: tee(2) nimmt den ganzen Block
+                ssize_t m = tee(scratch[0], filepipe[1], n, 0);
+                while (m > 0) {
+                    ssize_t w = splice(filepipe[0], NULL, outs[i], NULL, m, SPLICE_F_MOVE);
+                    if (w < 0 && errno == EINTR)
+                        continue;
+                    if (w <= 0)
+                        break;
+                    m -= w;
+                }
+                if (m != 0) {
+                    drop_output(outs, i, names);
+                    res = 1;
+                    // Rest aus filepipe werfen, damit der nächste Block wieder hineinpasst
+                    if (m > 0 && buf == NULL && (buf = malloc(cap)) == NULL)
+                        break;
+                    while (m > 0) {
+                        ssize_t r = read(filepipe[0], buf, m);
+                        if (r <= 0)
+                            break;
+                        m -= r;
+                    }
+                }
+            }
+        }
+
+        int last = nout - 1;
+        if (!any_partial) {
+            // Normalfall: die letzte Ausgabe verbraucht den Block ohne Kopie
+            ssize_t left = n;
+            while (left > 0 && outs[last] >= 0) {
+                ssize_t w = splice(scratch[0], NULL, outs[last], NULL, left, SPLICE_F_MOVE);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w <= 0) {
+                    drop_output(outs, last, names);
+                    res = 1;
+                    break;
+                }
+                left -= w;
+            }
+            if (left > 0 && outs[last] < 0) {
+                // Ausgabe ausgefallen: Rest des Blocks verwerfen
+                if (buf == NULL && (buf = malloc(cap)) == NULL)
+                    break;
+                while (left > 0) {
+                    ssize_t r = read(scratch[0], buf, left);
+                    if (r <= 0)
+                        break;
+                    left -= r;
+                }
+            }
+        } else {
+            // Block lesen (einmal kopieren) und die fehlenden Teile nachliefern
+            if (buf == NULL && (buf = malloc(cap)) == NULL)
+                break;
+            ssize_t got = 0;
+            while (got < n) {
+                ssize_t r = read(scratch[0], buf + got, n - got);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    break;
+                got += r;
+            }
+            for (int i = 0; i < nout; i++) {
+                size_t from = i == last ? 0 : (size_t)partial[i];
+                if (outs[i] >= 0 && from < (size_t)got && write_all(outs[i], buf + from, got - from) < 0) {
+                    drop_output(outs, i, names);
+                    res = 1;
+                }
+            }
+        }
+    }
+
+out:
+    close(scratch[0]);
+    close(scratch[1]);
+    if (filepipe[0] != -1) {
+        close(filepipe[0]);
+        close(filepipe[1]);
+    }
+    free(partial);
+    free(buf);
+    return res;
+}
+
+/* tee mit read/write: jeder Block geht an alle noch funktionierenden Ausgaben */
+static int tee_rw(int in, int *outs, int nout, const char **names) {
+    char *buf = malloc(ZEROCOPY_BUFFER);
+    int res = 0;
+
+    if (buf == NULL) {
+        perror("tee");
+        return 1;
+    }
+    while (outputs_alive(outs, nout) > 0) {
+        ssize_t n = read(in, buf, ZEROCOPY_BUFFER);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (n < 0) {
+                fprintf(stderr, "tee: read error: %s\n", strerror(errno));
+                res = 1;
+            }
+            break;
+        }
+        for (int i = 0; i < nout; i++) {
+            if (outs[i] >= 0 && write_all(outs[i], buf, n) < 0) {
+                drop_output(outs, i, names);
+                res = 1;
+            }
+        }
+    }
+    free(buf);
+    return res;
+}
+
+int stage_tee(char **argv, int fd_in, int fd_out) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int nout = 0;
+    int res = 0;
+    int i = skip_options(argv, "ai");
+
+    if (i < 0) {
+        fprintf(stderr, "tee: option not supported by the builtin (use /usr/bin/tee)\n");
+        return 2;
+    }
+    for (int o = 1; o < i; o++) {
+        if (strcmp(argv[o], "-a") == 0)
+            flags = (flags & ~O_TRUNC) | O_APPEND;
+    }
+
+    // Dateien zuerst, die Ausgabe der Stufe zuletzt: sie bekommt den Block per splice
+    int count = 0;
+    while (argv[i + count] != NULL)
+        count++;
+    int *outs = malloc((count + 1) * sizeof(int));
+    const char **names = malloc((count + 1) * sizeof(char *));
+    if (outs == NULL || names == NULL) {
+        perror("tee");
+        free(outs);
+        free(names);
+        return 1;
+    }
+    for (int f = 0; f < count; f++) {
+        int fd = open(argv[i + f], flags, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "tee: %s: %s\n", argv[i + f], strerror(errno));
+            res = 1;
+            continue;
+        }
+        names[nout] = argv[i + f];
+        outs[nout++] = fd;
+    }
+    names[nout] = "standard output";
+    outs[nout++] = fd_out;
+
+    // splice geht nur, wenn keine Ausgabe O_APPEND hat und alle Pipes oder Dateien sind
+    int can_splice = fd_kind(fd_in) != FD_OTHER;
+    for (int o = 0; o < nout && can_splice; o++) {
+        FdKind kind = fd_kind(outs[o]);
+        can_splice = (kind == FD_PIPE || kind == FD_FILE) && !is_append(outs[o]);
+    }
+
+    int copied = can_splice ? tee_splice(fd_in, outs, nout, names) : -1;
+    if (copied < 0)
+        copied = tee_rw(fd_in, outs, nout, names);
+    if (copied > 0)
+        res = 1;
+
+    for (int o = 0; o < nout - 1; o++) {
+        if (outs[o] >= 0)
+            close(outs[o]);
+    }
+    free(outs);
+    free(names);
+    return res;
+}
+
+int tee_accepts(char **argv) {
+    return skip_options(argv, "ai") >= 0;   // SIGINT (-i) ignoriert die Shell ohnehin
+}
+
+int builtin_tee(char **argv) {
+    return stage_tee(argv, STDIN_FILENO, STDOUT_FILENO);
+}
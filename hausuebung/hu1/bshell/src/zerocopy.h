@@ -0,0 +1,36 @@
+/*
+ * zerocopy.h
+ *
+ * Builtins "cat" und "tee", die Daten ohne Umweg über den Benutzerspeicher
+ * bewegen: splice(2) zwischen Pipe und Datei, tee(2) zum Verdoppeln von
+ * Pipe-Inhalten, copy_file_range(2) zwischen zwei Dateien. Passen die
+ * Deskriptoren nicht (Terminal, O_APPEND, ...), wird mit einem großen Puffer
+ * gelesen und geschrieben.
+ *
+ * Die Stufen-Varianten arbeiten nur mit den übergebenen Deskriptoren und
+ * können daher als Thread in einer Pipe laufen (siehe execute.c).
+ *
+ */
+
+#ifndef ZEROCOPY_H
+#define ZEROCOPY_H
+
+/* Kopiert alles von <in> nach <out>. Rückgabe: 0 oder -1 (errno gesetzt) */
+int zerocopy_copy(int in, int out);
+
+/*
+ * Die Builtins sind nur der schnelle Weg für die Optionen unten. Liefert
+ * *_accepts() 0 (z. B. "cat -n"), startet die Shell stattdessen das Programm.
+ */
+
+/* cat [-u] [datei...] ("-" = Eingabe) */
+int cat_accepts(char **argv);
+int stage_cat(char **argv, int fd_in, int fd_out);
+int builtin_cat(char **argv);
+
+/* tee [-a] [-i] [datei...] */
+int tee_accepts(char **argv);
+int stage_tee(char **argv, int fd_in, int fd_out);
+int builtin_tee(char **argv);
+
+#endif /* ZEROCOPY_H */